@@ -6,14 +6,68 @@
 #include <ctime>
 #include <cctype>
 #include <limits>
+#include <climits>
 #include <iomanip>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <sstream>
+#include <csignal>
+#include <coroutine>
+#include <bit>
+// vector text primitives: AVX2 or SSE2 when the build targets them
+#if defined(__AVX2__)
+#define TEXT_SIMD_WIDTH 32
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXT_SIMD_WIDTH 16
+#include <emmintrin.h>
+#else
+#define TEXT_SIMD_WIDTH 0
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <dirent.h>
+#include <cerrno>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#endif
+#endif
 
 using namespace std;
 
 /* ========== Configuration ========== */
 const char* ROOMS_TXT = "rooms.txt";
+const char* ROOMS_PACK = "rooms.bin";
+const char* ROOMS_INDEX = "rooms.idx"; // room offsets into ROOMS_TXT, for lazy loading
 const char* SAVE_BIN = "savegame.dat";
-const char* HIGHSCORES_BIN = "highscores.dat";
+const char* SAVE_JOURNAL = "savegame.jnl"; // deltas appended after the SAVE_BIN snapshot
+const char* HIGHSCORES_BIN = "highscores.dat"; // pre-segment store, imported into HIGHSCORES_DIR
 
 const int MAX_ROOM_NAME = 128;
 const int MAX_DESC = 512;
@@ -23,53 +77,115 @@ const int MAX_PLAYER_NAME = 32;
 
 /* ========== Global data  ========== */
 
+// The catalog globals below are this thread's view of one catalog version
+// (see Catalog versions): loaders fill them in, bindCatalog points them at a
+// version, and a hot reload builds the next version on its own thread.
+
 // Rooms
-int totalRooms = 0;
-char** roomNames = nullptr;
-char** roomDescriptions = nullptr;
-int* roomObjectCount = nullptr;
-int* roomObjectStart = nullptr;
+thread_local int totalRooms = 0;
+thread_local char** roomNames = nullptr;
+thread_local char** roomDescriptions = nullptr;
+thread_local int* roomObjectCount = nullptr;
+thread_local int* roomObjectStart = nullptr;
 
 // Objects (flat arrays)
-int totalObjects = 0;
-char** objectNames = nullptr;
-char** objectDescriptions = nullptr;
-int* objectHasPuzzle = nullptr;
-int* objectPuzzleType = nullptr;
-char** objectPuzzlePrompt = nullptr;
-char** objectPuzzleAnswer = nullptr;
-int* objectGivesItem = nullptr;
-char** objectItemName = nullptr;
-int* objectSolved = nullptr;
-
-// Inventory
-char** inventory = nullptr;
-int invCount = 0;
-int invCapacity = 0;
-
-// Runtime state
-int currentRoomIndex = 0;
-int totalMoves = 0;
-int hintsUsed = 0;
-time_t startTime = 0;
-int accumulatedElapsed = 0;
-int difficultyLevel = 2; // 1=Easy,2=Medium,3=Hard
-
-// Last-game summary snapshot (for main menu viewing)
-bool lastSummaryAvailable = false;
-int lastRoomsExplored = 0;
-int lastTotalMoves = 0;
-int lastElapsedSec = 0;
-int lastHintsUsed = 0;
-int lastDifficulty = 2;
-int lastFinalScore = 0;
-char** lastItemsCollected = nullptr;
-int lastItemsCount = 0;
-char** lastAchievements = nullptr;
-int lastAchievementsCount = 0;
-
-// Quit-to-main control flag
-bool exitToMainRequested = false;
+thread_local int totalObjects = 0;
+thread_local char** objectNames = nullptr;
+thread_local char** objectDescriptions = nullptr;
+thread_local int* objectHasPuzzle = nullptr;
+thread_local int* objectPuzzleType = nullptr;
+thread_local char** objectPuzzlePrompt = nullptr;
+thread_local char** objectPuzzleAnswer = nullptr;
+thread_local int* objectGivesItem = nullptr;
+thread_local char** objectItemName = nullptr;
+
+// Item interactions, one per "USE <item> ON <object> = <effects>" line of
+// rooms.txt; the object is a catalog index and the effect a UseEffect mask
+thread_local int totalInteractions = 0;
+thread_local char** interactionItemName = nullptr;
+thread_local int* interactionObject = nullptr;
+thread_local int* interactionEffect = nullptr;
+
+// Item dictionary: each distinct item name (ignoring case) gets a dense id
+// when the catalog loads; inventories and saves hold ids, not names.
+thread_local int totalItems = 0;
+thread_local const char** itemNames = nullptr;  // display name, from the first object giving it
+thread_local int* objectItemId = nullptr;       // -1 if the object gives no item
+thread_local int* itemTable = nullptr;          // open-addressed ids by name, -1 = empty
+thread_local size_t itemTableMask = 0;
+
+// View of one of the bound catalog's tables. Lookups read like the vector
+// itself; loaders grow or clear it through ->.
+template <typename T>
+struct CatalogVector {
+	vector<T>* v = nullptr;
+	T &operator[](size_t i) const { return (*v)[i]; }
+	size_t size() const { return v->size(); }
+	bool empty() const { return v->empty(); }
+	T* data() const { return v->data(); }
+	vector<T>* operator->() const { return v; }
+	vector<T> &operator*() const { return *v; }
+};
+
+// Per room, a hash of its block of rooms.txt; with --watch a reload skips
+// the rooms whose hash did not change (empty otherwise).
+thread_local CatalogVector<uint64_t> roomHashes;
+
+struct Catalog;
+thread_local Catalog* boundCatalog = nullptr; // version the globals above view
+
+// Everything one player's game needs besides the catalog, which is read-only
+// once loaded. The console plays a single session; the session host
+// (--host-bench) runs thousands of them side by side.
+struct GameSession {
+	// Catalog version the session plays; a newer one is adopted between games
+	shared_ptr<Catalog> catalog;
+
+	// Solved state: one bit per object plus a per-room count of unsolved objects
+	unsigned int* objectSolvedBits = nullptr;
+	int* roomUnsolvedCount = nullptr;
+
+	// Puzzle order: catalog object whose puzzle each object presents,
+	// shuffled from layoutSeed (saved, so a load rebuilds the same layout)
+	int* puzzleSource = nullptr;
+	uint64_t layoutSeed = 0;
+
+	// Inventory: item ids in pickup order plus one held bit per item id
+	int* inventory = nullptr;
+	int invCount = 0;
+	int invCapacity = 0;
+	unsigned int* itemHeldBits = nullptr;
+
+	// Runtime state
+	int currentRoomIndex = 0;
+	int totalMoves = 0;
+	int hintsUsed = 0;
+	time_t startTime = 0;
+	int accumulatedElapsed = 0;
+	int difficultyLevel = 2; // 1=Easy,2=Medium,3=Hard
+
+	// Changes since the last save (see the save journal)
+	vector<char> journalPending;
+	bool journalRecording = true;     // off while a save is being loaded or replayed
+	bool journalNeedsSnapshot = true; // state has no snapshot on disk yet (new game)
+	int autosaveMovesMark = 0;        // totalMoves at the last autosave
+
+	// Last-game summary snapshot (for main menu viewing)
+	bool lastSummaryAvailable = false;
+	int lastRoomsExplored = 0;
+	int lastTotalMoves = 0;
+	int lastElapsedSec = 0;
+	int lastHintsUsed = 0;
+	int lastDifficulty = 2;
+	int lastFinalScore = 0;
+	int* lastItemsCollected = nullptr;  // item ids
+	int lastItemsCount = 0;
+	char** lastAchievements = nullptr;
+	int lastAchievementsCount = 0;
+
+	// Quit-to-main control flag
+	bool exitToMainRequested = false;
+};
 
 /* ========== Utility helpers ========== */
 
@@ -85,99 +201,447 @@ void clearScreen() {
 
 }
 
+/* ========== Text primitives ========== */
+
+// Newline, whitespace, digit and keyword tests run on every line of
+// rooms.txt and on every typed answer. With TEXT_SIMD_WIDTH set they test
+// 16 (SSE2) or 32 (AVX2) bytes per step and finish with the byte loops,
+// which are also the whole implementation on other targets. Most spans are
+// short and start and end on a non-blank byte, so those cases are answered
+// before any vector is loaded. Whitespace and digits are the "C" locale
+// sets; case folding is ASCII only, like _stricmp.
+bool isSpaceByte(unsigned char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+bool isDigitByte(unsigned char c) { return c >= '0' && c <= '9'; }
+char foldUpper(char c) { return (c >= 'a' && c <= 'z') ? (char)(c - 32) : c; }
+
+size_t skipSpacesScalar(const char* s, size_t n) {
+	size_t i = 0;
+	while (i < n && isSpaceByte((unsigned char)s[i])) ++i;
+	return i;
+}
+
+// End of [0, ed) without its trailing whitespace.
+size_t trimSpacesEndScalar(const char* s, size_t ed) {
+	while (ed > 0 && isSpaceByte((unsigned char)s[ed - 1])) --ed;
+	return ed;
+}
 
-void pressEnterToContinue() {
-	cout << "\nPress Enter to continue...";
-	string tmp;
-	getline(cin, tmp);
+bool allDigitsScalar(const char* s, size_t n) {
+	for (size_t i = 0; i < n; ++i) if (!isDigitByte((unsigned char)s[i])) return false;
+	return true;
 }
 
-string readLineTrimmedFromCin() {
-	string s;
-	getline(cin, s);
+bool foldedEqualsScalar(const char* s, const char* kw, size_t n) {
+	for (size_t i = 0; i < n; ++i) if (foldUpper(s[i]) != foldUpper(kw[i])) return false;
+	return true;
+}
+
+void asciiLowerScalar(char* s, size_t n) {
+	for (size_t i = 0; i < n; ++i) if (s[i] >= 'A' && s[i] <= 'Z') s[i] = (char)(s[i] + 32);
+}
+
+#if TEXT_SIMD_WIDTH == 32
+typedef __m256i TextVec;
+const uint32_t TEXT_FULL_MASK = 0xFFFFFFFFu;
+inline TextVec textLoad(const char* p) { return _mm256_loadu_si256((const __m256i*)p); }
+inline void textStore(char* p, TextVec v) { _mm256_storeu_si256((__m256i*)p, v); }
+inline TextVec textSplat(char c) { return _mm256_set1_epi8(c); }
+inline TextVec textEq(TextVec a, TextVec b) { return _mm256_cmpeq_epi8(a, b); }
+inline TextVec textGt(TextVec a, TextVec b) { return _mm256_cmpgt_epi8(a, b); }
+inline TextVec textAnd(TextVec a, TextVec b) { return _mm256_and_si256(a, b); }
+inline TextVec textOr(TextVec a, TextVec b) { return _mm256_or_si256(a, b); }
+inline TextVec textAdd(TextVec a, TextVec b) { return _mm256_add_epi8(a, b); }
+inline TextVec textSub(TextVec a, TextVec b) { return _mm256_sub_epi8(a, b); }
+inline uint32_t textMask(TextVec v) { return (uint32_t)_mm256_movemask_epi8(v); }
+#elif TEXT_SIMD_WIDTH == 16
+typedef __m128i TextVec;
+const uint32_t TEXT_FULL_MASK = 0xFFFFu;
+inline TextVec textLoad(const char* p) { return _mm_loadu_si128((const __m128i*)p); }
+inline void textStore(char* p, TextVec v) { _mm_storeu_si128((__m128i*)p, v); }
+inline TextVec textSplat(char c) { return _mm_set1_epi8(c); }
+inline TextVec textEq(TextVec a, TextVec b) { return _mm_cmpeq_epi8(a, b); }
+inline TextVec textGt(TextVec a, TextVec b) { return _mm_cmpgt_epi8(a, b); }
+inline TextVec textAnd(TextVec a, TextVec b) { return _mm_and_si128(a, b); }
+inline TextVec textOr(TextVec a, TextVec b) { return _mm_or_si128(a, b); }
+inline TextVec textAdd(TextVec a, TextVec b) { return _mm_add_epi8(a, b); }
+inline TextVec textSub(TextVec a, TextVec b) { return _mm_sub_epi8(a, b); }
+inline uint32_t textMask(TextVec v) { return (uint32_t)_mm_movemask_epi8(v); }
+#endif
+
+#if TEXT_SIMD_WIDTH
+// Signed compares: bytes >= 0x80 are negative and fall outside every range.
+inline uint32_t spaceMask(TextVec v) {
+	TextVec ctl = textAnd(textGt(v, textSplat('\t' - 1)), textGt(textSplat('\r' + 1), v));
+	return textMask(textOr(textEq(v, textSplat(' ')), ctl));
+}
+inline uint32_t digitMask(TextVec v) {
+	return textMask(textAnd(textGt(v, textSplat('0' - 1)), textGt(textSplat('9' + 1), v)));
+}
+inline TextVec inRange(TextVec v, char lo, char hi) {
+	return textAnd(textGt(v, textSplat((char)(lo - 1))), textGt(textSplat((char)(hi + 1)), v));
+}
+inline TextVec foldUpperVec(TextVec v) {
+	return textSub(v, textAnd(inRange(v, 'a', 'z'), textSplat(32)));
+}
+#endif
+
+// Index of the first non-whitespace byte of s[0, n) (n if there is none).
+inline size_t skipSpaces(const char* s, size_t n) {
+	if (n == 0 || !isSpaceByte((unsigned char)s[0])) return 0;
+	size_t i = 0;
+#if TEXT_SIMD_WIDTH
+	for (; i + TEXT_SIMD_WIDTH <= n; i += TEXT_SIMD_WIDTH) {
+		uint32_t m = spaceMask(textLoad(s + i));
+		if (m != TEXT_FULL_MASK) return i + (size_t)countr_one(m);
+	}
+#endif
+	return i + skipSpacesScalar(s + i, n - i);
+}
+
+// End of s[0, ed) without its trailing whitespace.
+inline size_t trimSpacesEnd(const char* s, size_t ed) {
+	if (ed == 0 || !isSpaceByte((unsigned char)s[ed - 1])) return ed;
+#if TEXT_SIMD_WIDTH
+	for (; ed >= TEXT_SIMD_WIDTH; ed -= TEXT_SIMD_WIDTH) {
+		uint32_t m = spaceMask(textLoad(s + ed - TEXT_SIMD_WIDTH));
+		if (m != TEXT_FULL_MASK) return ed - (size_t)countl_one(m << (32 - TEXT_SIMD_WIDTH));
+	}
+#endif
+	return trimSpacesEndScalar(s, ed);
+}
+
+inline bool allDigits(const char* s, size_t n) {
+	size_t i = 0;
+#if TEXT_SIMD_WIDTH
+	for (; i + TEXT_SIMD_WIDTH <= n; i += TEXT_SIMD_WIDTH) {
+		if (digitMask(textLoad(s + i)) != TEXT_FULL_MASK) return false;
+	}
+#endif
+	return allDigitsScalar(s + i, n - i);
+}
+
+// Case-insensitive compare of n bytes. Keywords are shorter than a vector
+// and spanIEquals rejects most lines on length first, so only long spans
+// (object names in USE lines) take the vector loop.
+inline bool foldedEquals(const char* s, const char* kw, size_t n) {
+#if TEXT_SIMD_WIDTH
+	if (n < TEXT_SIMD_WIDTH) return foldedEqualsScalar(s, kw, n);
+	size_t i = 0;
+	for (; i + TEXT_SIMD_WIDTH <= n; i += TEXT_SIMD_WIDTH) {
+		if (textMask(textEq(foldUpperVec(textLoad(s + i)), foldUpperVec(textLoad(kw + i)))) != TEXT_FULL_MASK) return false;
+	}
+	return foldedEqualsScalar(s + i, kw + i, n - i);
+#else
+	return foldedEqualsScalar(s, kw, n);
+#endif
+}
+
+void asciiLower(char* s, size_t n) {
 	size_t i = 0;
-	while (i < s.size() && isspace((unsigned char)s[i])) ++i;
-	size_t j = s.size();
-	while (j > i && isspace((unsigned char)s[j - 1])) --j;
-	return s.substr(i, j - i);
+#if TEXT_SIMD_WIDTH
+	for (; i + TEXT_SIMD_WIDTH <= n; i += TEXT_SIMD_WIDTH) {
+		TextVec v = textLoad(s + i);
+		textStore(s + i, textAdd(v, textAnd(inRange(v, 'A', 'Z'), textSplat(32))));
+	}
+#endif
+	asciiLowerScalar(s + i, n - i);
+}
+
+// Splits off the line at p: its trimmed span (s, n) and where the next line
+// starts. A line that ends inside one vector (most rooms.txt lines) takes a
+// single load: the newline and both trim points come out of its masks.
+inline void splitLine(const char* p, const char* end, const char* &s, size_t &n, const char* &next) {
+#if TEXT_SIMD_WIDTH
+	if (p + TEXT_SIMD_WIDTH <= end) {
+		TextVec v = textLoad(p);
+		uint32_t nl = textMask(textEq(v, textSplat('\n')));
+		if (nl) {
+			int at = countr_zero(nl);
+			uint32_t text = ~spaceMask(v) & ((1u << at) - 1);
+			int st = text ? countr_zero(text) : at;
+			s = p + st;
+			n = text ? (size_t)(32 - countl_zero(text) - st) : 0;
+			next = p + at + 1;
+			return;
+		}
+	}
+#endif
+	const char* nl = (const char*)memchr(p, '\n', (size_t)(end - p));
+	const char* le = nl ? nl : end;
+	s = p + skipSpaces(p, (size_t)(le - p));
+	n = trimSpacesEnd(s, (size_t)(le - s));
+	next = nl ? nl + 1 : end;
+}
+
+// Value of up to 9 decimal digits (cannot overflow an int).
+int parseDigits9(const char* s, size_t n) {
+	int v = 0;
+	for (size_t i = 0; i < n; ++i) v = v * 10 + (s[i] - '0');
+	return v;
 }
 
 string trimStr(const string &s) {
-	size_t st = 0;
-	while (st < s.size() && isspace((unsigned char)s[st])) ++st;
-	size_t ed = s.size();
-	while (ed > st && isspace((unsigned char)s[ed - 1])) --ed;
+	size_t st = skipSpaces(s.data(), s.size());
+	size_t ed = st + trimSpacesEnd(s.data() + st, s.size() - st);
 	return s.substr(st, ed - st);
 }
 
-int safeAtoi(const char* s) {
-	if (!s) return 0;
-	string t(s);
-	size_t st = 0; while (st < t.size() && isspace((unsigned char)t[st])) ++st;
-	size_t ed = t.size(); while (ed > st && isspace((unsigned char)t[ed - 1])) --ed;
+int safeAtoiSpan(const char* s, size_t n) {
+	size_t st = skipSpaces(s, n);
+	size_t ed = st + trimSpacesEnd(s + st, n - st);
 	if (st >= ed) return 0;
 	bool neg = false; size_t idx = st;
-	if (t[idx] == '-') { neg = true; ++idx; }
+	if (s[idx] == '-') { neg = true; ++idx; }
+	// the common case: a short all-digit field
+	if (ed - idx <= 9 && allDigits(s + idx, ed - idx)) {
+		int v = parseDigits9(s + idx, ed - idx);
+		return neg ? -v : v;
+	}
 	long long v = 0;
 	for (; idx < ed; ++idx) {
-		if (!isdigit((unsigned char)t[idx])) return 0;
-		v = v * 10 + (t[idx] - '0');
+		if (!isdigit((unsigned char)s[idx])) return 0;
+		v = v * 10 + (s[idx] - '0');
 		if (v > INT_MAX) break;
 	}
 	return neg ? -(int)v : (int)v;
 }
 
-int readIntInRange(int lo, int hi) {
-	string line;
-	while (true) {
-		line = readLineTrimmedFromCin();
-		if (line.size() == 0) {
-			cout << "Please enter a number: ";
-			continue;
-		}
-		bool valid = true;
-		size_t idx = 0;
-		if (line[0] == '-' || line[0] == '+') idx = 1;
-		for (; idx < line.size(); ++idx) {
-			if (!isdigit((unsigned char)line[idx])) { valid = false; break; }
-		}
-		if (!valid) {
-			cout << "Invalid input. Enter a number: ";
-			continue;
-		}
-		long long v = 0;
-		try { v = stoll(line); }
-		catch (...) { valid = false; }
-		if (!valid || v < lo || v > hi) {
-			cout << "Enter number between " << lo << " and " << hi << ": ";
-			continue;
-		}
-		return (int)v;
-	}
+int safeAtoi(const char* s) {
+	if (!s) return 0;
+	return safeAtoiSpan(s, strlen(s));
 }
 
-bool readYesNo() {
-	while (true) {
-		string s = readLineTrimmedFromCin();
-		if (s.size() == 0) {
-			cout << "Please enter y/n: ";
-			continue;
-		}
-		char c = tolower((unsigned char)s[0]);
-		if (c == 'y') return true;
-		if (c == 'n') return false;
-		cout << "Please enter y/n: ";
+// Parses a trimmed answer to a number prompt; on failure 'retry' holds the re-prompt.
+bool parseIntInRange(const string &line, int lo, int hi, int &value, string &retry) {
+	if (line.size() == 0) { retry = "Please enter a number: "; return false; }
+	bool valid = true;
+	size_t idx = 0;
+	if (line[0] == '-' || line[0] == '+') idx = 1;
+	valid = allDigits(line.data() + idx, line.size() - idx);
+	if (!valid) { retry = "Invalid input. Enter a number: "; return false; }
+	long long v = 0;
+	try { v = stoll(line); }
+	catch (...) { valid = false; }
+	if (!valid || v < lo || v > hi) {
+		retry = "Enter number between " + to_string(lo) + " and " + to_string(hi) + ": ";
+		return false;
 	}
+	value = (int)v;
+	return true;
+}
+
+// 1 = yes, 0 = no, -1 = ask again
+int parseYesNo(const string &s) {
+	if (s.size() == 0) return -1;
+	char c = tolower((unsigned char)s[0]);
+	if (c == 'y') return 1;
+	if (c == 'n') return 0;
+	return -1;
 }
 
 string toLowerTrim(const string &s) {
-	size_t st = 0; while (st < s.size() && isspace((unsigned char)s[st])) ++st;
-	size_t ed = s.size(); while (ed > st && isspace((unsigned char)s[ed - 1])) --ed;
-	string t = s.substr(st, ed - st);
-	for (size_t i = 0; i < t.size(); ++i) t[i] = tolower((unsigned char)t[i]);
+	string t = trimStr(s);
+	asciiLower(&t[0], t.size());
 	return t;
 }
 
+/* ========== Command traces ========== */
+
+// --record=FILE writes everything the player types to a compact binary trace
+// so a session can be replayed later (--replay). Layout: "ESCT", version (1),
+// flags (1, bit 0 = server session, bit 1 = typo tolerance off), catalog
+// object count (4), then records:
+//   LINE  type | varint ms since the previous line | varint length | bytes
+//   SEED  type | 8-byte layout seed of a game the player started
+//   LOAD  type                  (the session resumed savegame.dat)
+//   END   type | 8-byte digest of the final session state
+enum TraceRecordType { TR_LINE = 1, TR_SEED = 2, TR_LOAD = 3, TR_END = 4 };
+const unsigned char TRACE_VERSION = 1;
+const size_t TRACE_FLUSH_BYTES = 64 * 1024;
+
+string tracePath; // --record=FILE; server sessions add ".<n>"
+extern bool typoTolerance;
+
+struct TraceWriter {
+	ofstream file;
+	vector<char> buf;
+	chrono::steady_clock::time_point last;
+};
+
+void tracePutVarint(vector<char> &out, uint64_t v) {
+	while (v >= 0x80) { out.push_back((char)(v | 0x80)); v >>= 7; }
+	out.push_back((char)v);
+}
+
+void traceFlush(TraceWriter &t) {
+	if (t.buf.empty()) return;
+	t.file.write(t.buf.data(), (streamsize)t.buf.size());
+	t.buf.clear();
+}
+
+bool traceOpen(TraceWriter &t, const string &path, bool network) {
+	t.file.open(path.c_str(), ios::binary | ios::trunc);
+	if (!t.file) return false;
+	t.buf.insert(t.buf.end(), "ESCT", "ESCT" + 4);
+	t.buf.push_back((char)TRACE_VERSION);
+	t.buf.push_back((char)((network ? 1 : 0) | (typoTolerance ? 0 : 2)));
+	uint32_t objects = (uint32_t)totalObjects;
+	t.buf.insert(t.buf.end(), (const char*)&objects, (const char*)&objects + sizeof(objects));
+	t.last = chrono::steady_clock::now();
+	return true;
+}
+
+void traceLine(TraceWriter &t, const string &line) {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	t.buf.push_back((char)TR_LINE);
+	tracePutVarint(t.buf, (uint64_t)chrono::duration_cast<chrono::milliseconds>(now - t.last).count());
+	tracePutVarint(t.buf, line.size());
+	t.buf.insert(t.buf.end(), line.begin(), line.end());
+	t.last = now;
+	if (t.buf.size() >= TRACE_FLUSH_BYTES) traceFlush(t);
+}
+
+void traceValue(TraceWriter &t, TraceRecordType type, uint64_t value) {
+	t.buf.push_back((char)type);
+	t.buf.insert(t.buf.end(), (const char*)&value, (const char*)&value + sizeof(value));
+}
+
+void traceClose(TraceWriter &t, uint64_t digest) {
+	traceValue(t, TR_END, digest);
+	traceFlush(t);
+	t.file.close();
+}
+
+/* ========== Coroutine prompts ========== */
+
+// Every prompt is a co_await on the player's next line, so a session waiting
+// for input is only its suspended coroutine frames. The console feeds lines
+// from cin; the server feeds them from each connection's socket.
+struct TaskPromiseBase {
+	coroutine_handle<> continuation; // the awaiting coroutine, resumed when this one returns
+	struct FinalAwaiter {
+		bool await_ready() noexcept { return false; }
+		template<typename P> coroutine_handle<> await_suspend(coroutine_handle<P> h) noexcept {
+			coroutine_handle<> next = h.promise().continuation;
+			return next ? next : noop_coroutine();
+		}
+		void await_resume() noexcept {}
+	};
+	suspend_always initial_suspend() noexcept { return {}; }
+	FinalAwaiter final_suspend() noexcept { return {}; }
+	void unhandled_exception() { terminate(); }
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase {
+	T value;
+	void return_value(T v) { value = std::move(v); }
+	T result() { return std::move(value); }
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+	void return_void() {}
+	void result() {}
+};
+
+// Lazily started coroutine that owns its frame; co_await runs it to completion.
+template<typename T = void>
+struct Task {
+	struct promise_type : TaskPromise<T> {
+		Task get_return_object() { return Task(coroutine_handle<promise_type>::from_promise(*this)); }
+	};
+	coroutine_handle<promise_type> h;
+
+	Task() : h(nullptr) {}
+	explicit Task(coroutine_handle<promise_type> handle) : h(handle) {}
+	Task(Task &&o) noexcept : h(o.h) { o.h = nullptr; }
+	Task& operator=(Task &&o) noexcept {
+		if (this != &o) { if (h) h.destroy(); h = o.h; o.h = nullptr; }
+		return *this;
+	}
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+	~Task() { if (h) h.destroy(); }
+
+	bool done() const { return !h || h.done(); }
+	// Runs a top-level task up to its first suspension.
+	void start() { if (h && !h.done()) h.resume(); }
+
+	bool await_ready() const noexcept { return false; }
+	coroutine_handle<> await_suspend(coroutine_handle<> caller) noexcept {
+		h.promise().continuation = caller;
+		return h;
+	}
+	T await_resume() { return h.promise().result(); }
+};
+
+// A player's screen: the room view is composed into 'frame' and written in
+// one call. With --ansi the frame last written is kept in 'shown', so a frame
+// drawn over an undisturbed one only rewrites the lines that changed.
+struct FrameRenderer {
+	string frame;
+	vector<uint32_t> frameLines;  // start of each line in 'frame'
+	string shown;
+	vector<uint32_t> shownLines;
+	string ansi;                  // escape sequences plus changed lines
+	bool onScreen = false;        // 'shown' is still what the terminal displays
+};
+
+// One player's input/output channel.
+struct PlayerIO {
+	ostream* out = &cout;
+	bool network = false;       // server sessions: no save slot, no autosave
+	bool dryRun = false;        // replays: same prompts, but no save or high score files
+	string line;
+	coroutine_handle<> waiter;  // the prompt suspended on the next line
+	TraceWriter* trace = nullptr;
+	deque<uint64_t> replaySeeds; // layout seeds read back from a trace
+	FrameRenderer screen;
+};
+
+struct LineAwaiter {
+	PlayerIO &io;
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(coroutine_handle<> h) noexcept { io.waiter = h; }
+	string await_resume() { return std::move(io.line); }
+};
+
+// Hands a line to the prompt waiting on it and runs the session until its
+// next prompt; false if nothing was waiting.
+bool feedLine(PlayerIO &io, const string &line) {
+	if (!io.waiter) return false;
+	coroutine_handle<> h = io.waiter;
+	io.waiter = nullptr;
+	if (io.trace) traceLine(*io.trace, line);
+	io.line = line;
+	h.resume();
+	return true;
+}
+
+Task<string> askLine(PlayerIO &io) {
+	string s = co_await LineAwaiter{ io };
+	co_return trimStr(s);
+}
+
+Task<int> askIntInRange(PlayerIO &io, int lo, int hi) {
+	string retry;
+	int v = 0;
+	while (!parseIntInRange(co_await askLine(io), lo, hi, v, retry)) *io.out << retry;
+	co_return v;
+}
+
+Task<bool> askYesNo(PlayerIO &io) {
+	int yn;
+	while ((yn = parseYesNo(co_await askLine(io))) < 0) *io.out << "Please enter y/n: ";
+	co_return yn == 1;
+}
+
+Task<void> askEnter(PlayerIO &io) {
+	*io.out << "\nPress Enter to continue...";
+	co_await LineAwaiter{ io };
+}
+
 /* ========== Memory / String helpers ========== */
 
 char* allocCstrFromStd(const string &s) {
@@ -195,56 +659,276 @@ char* allocEmptyCstr() {
 	return p;
 }
 
+/* ========== Catalog string arena ========== */
+
+// Bump allocator that owns all catalog text (room/object names, descriptions,
+// prompts, answers, item names). Strings are packed back to back in a few
+// large blocks in file order, and the whole catalog is released by dropping
+// the blocks instead of delete[]-ing every string.
+const size_t ARENA_FIRST_BLOCK = 64 * 1024;
+const size_t ARENA_MAX_BLOCK = 16 * 1024 * 1024;
+
+struct StringArena {
+	char* block;          // current block; its first bytes link to the previous block
+	size_t used;
+	size_t cap;
+	size_t nextBlockSize;
+	size_t bytesUsed;     // payload bytes handed out
+	size_t bytesReserved; // bytes held in blocks
+	int blockCount;
+};
+
+thread_local StringArena catalogArena = { nullptr, 0, 0, ARENA_FIRST_BLOCK, 0, 0, 0 };
+
+char* arenaAlloc(StringArena &a, size_t n) {
+	if (a.block == nullptr || a.used + n > a.cap) {
+		size_t payload = a.nextBlockSize;
+		if (payload < n) payload = n;
+		char* blk = new(nothrow) char[sizeof(char*) + payload];
+		if (!blk) { cerr << "Memory allocation failed\n"; exit(1); }
+		memcpy(blk, &a.block, sizeof(char*));
+		a.block = blk;
+		a.used = sizeof(char*);
+		a.cap = sizeof(char*) + payload;
+		a.bytesReserved += sizeof(char*) + payload;
+		++a.blockCount;
+		if (a.nextBlockSize < ARENA_MAX_BLOCK) a.nextBlockSize *= 2;
+	}
+	char* p = a.block + a.used;
+	a.used += n;
+	a.bytesUsed += n;
+	return p;
+}
+
+char* arenaCopy(StringArena &a, const char* s, size_t n) {
+	char* p = arenaAlloc(a, n + 1);
+	memcpy(p, s, n);
+	p[n] = '\0';
+	return p;
+}
+
+// Moves the blocks of 'from' into 'a' (per-thread arenas are merged this
+// way); 'from' is left empty.
+void arenaAdopt(StringArena &a, StringArena &from) {
+	if (from.block == nullptr) return;
+	char* oldest = from.block;
+	while (true) {
+		char* prev;
+		memcpy(&prev, oldest, sizeof(char*));
+		if (!prev) break;
+		oldest = prev;
+	}
+	memcpy(oldest, &a.block, sizeof(char*));
+	a.block = from.block;
+	a.used = from.used;
+	a.cap = from.cap;
+	a.bytesUsed += from.bytesUsed;
+	a.bytesReserved += from.bytesReserved;
+	a.blockCount += from.blockCount;
+	from.block = nullptr;
+	from.used = 0;
+	from.cap = 0;
+	from.bytesUsed = 0;
+	from.bytesReserved = 0;
+	from.blockCount = 0;
+}
+
+void arenaRelease(StringArena &a) {
+	char* blk = a.block;
+	while (blk) {
+		char* prev;
+		memcpy(&prev, blk, sizeof(char*));
+		delete[] blk;
+		blk = prev;
+	}
+	a.block = nullptr;
+	a.used = 0;
+	a.cap = 0;
+	a.nextBlockSize = ARENA_FIRST_BLOCK;
+	a.bytesUsed = 0;
+	a.bytesReserved = 0;
+	a.blockCount = 0;
+}
+
+/* ========== Save journal (pending deltas) ========== */
+
+// A session keeps the changes made since its last save, already encoded as
+// journal records (GameSession::journalPending). A journaled save appends
+// them to SAVE_JOURNAL behind the snapshot in SAVE_BIN instead of rewriting
+// the whole file (see saveProgress).
+// JR_ITEM_ADD carries an item name and is only read from older journals.
+enum JournalRecordType { JR_SOLVED = 1, JR_ITEM_ADD = 2, JR_ITEM_REMOVE = 3, JR_COUNTERS = 4, JR_ITEM_ID = 5 };
+
+int autosaveEveryMoves = 0; // --autosave=N; 0 = off
+
+// FNV-1a, used to reject torn or corrupted records.
+uint32_t journalChecksum(const char* p, size_t n) {
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < n; ++i) { h ^= (unsigned char)p[i]; h *= 16777619u; }
+	return h;
+}
+
+// Record layout: type (1) | payload length (2) | payload | checksum of the preceding bytes (4).
+void journalPut(vector<char> &out, unsigned char type, const void* payload, unsigned short len) {
+	size_t at = out.size();
+	out.resize(at + 3 + len + 4);
+	char* p = &out[at];
+	p[0] = (char)type;
+	memcpy(p + 1, &len, 2);
+	if (len > 0) memcpy(p + 3, payload, len);
+	uint32_t sum = journalChecksum(p, 3 + len);
+	memcpy(p + 3 + len, &sum, 4);
+}
+
+void journalRecord(GameSession &gs, unsigned char type, const void* payload, unsigned short len) {
+	if (!gs.journalRecording || gs.journalNeedsSnapshot) return;
+	journalPut(gs.journalPending, type, payload, len);
+}
+
+// Drops the pending deltas; the next save writes a full snapshot.
+void journalStartOver(GameSession &gs) {
+	gs.journalPending.clear();
+	gs.journalNeedsSnapshot = true;
+}
+
 /* ========== Inventory functions ========== */
 
-void ensureInvCapacity() {
-	if (invCapacity == 0) {
-		invCapacity = 4;
-		inventory = new(nothrow) char*[invCapacity];
-		if (!inventory) { cerr << "Memory alloc failed\n"; exit(1); }
+int itemWordCount() {
+	return (totalItems + 31) / 32;
+}
+
+void ensureInvCapacity(GameSession &gs) {
+	if (gs.invCapacity == 0) {
+		gs.invCapacity = 4;
+		gs.inventory = new(nothrow) int[gs.invCapacity];
+		if (!gs.inventory) { cerr << "Memory alloc failed\n"; exit(1); }
 	}
-	else if (invCount >= invCapacity) {
-		int newCap = invCapacity * 2;
-		char** tmp = new(nothrow) char*[newCap];
+	else if (gs.invCount >= gs.invCapacity) {
+		int newCap = gs.invCapacity * 2;
+		int* tmp = new(nothrow) int[newCap];
 		if (!tmp) { cerr << "Memory alloc failed\n"; exit(1); }
-		for (int i = 0; i < invCount; ++i) tmp[i] = inventory[i];
-		delete[] inventory;
-		inventory = tmp;
-		invCapacity = newCap;
+		for (int i = 0; i < gs.invCount; ++i) tmp[i] = gs.inventory[i];
+		delete[] gs.inventory;
+		gs.inventory = tmp;
+		gs.invCapacity = newCap;
 	}
 }
 
-void addInventory(const char* name) {
-	if (!name) return;
-	if (strlen(name) == 0) return;
-	ensureInvCapacity();
-	inventory[invCount] = allocCstrFromStd(string(name));
-	++invCount;
-	cout << "Added to inventory: " << name << "\n";
+bool inventoryContains(GameSession &gs, int itemId) {
+	if (itemId < 0 || itemId >= totalItems) return false;
+	return (gs.itemHeldBits[itemId >> 5] >> (itemId & 31)) & 1u;
+}
+
+void addInventory(GameSession &gs, int itemId) {
+	if (itemId < 0 || itemId >= totalItems) return;
+	ensureInvCapacity(gs);
+	gs.inventory[gs.invCount++] = itemId;
+	gs.itemHeldBits[itemId >> 5] |= 1u << (itemId & 31);
+	int32_t id = itemId;
+	journalRecord(gs, JR_ITEM_ID, &id, sizeof(id));
+}
+
+void clearInventory(GameSession &gs) {
+	gs.invCount = 0;
+	for (int i = 0; i < itemWordCount(); ++i) gs.itemHeldBits[i] = 0;
 }
 
-void showInventory() {
-	cout << "Inventory (" << invCount << "):\n";
-	if (invCount == 0) { cout << " - Empty -\n"; return; }
-	for (int i = 0; i < invCount; ++i) {
-		cout << (i + 1) << ". " << inventory[i] << "\n";
+void showInventory(GameSession &gs, ostream &out) {
+	out << "Inventory (" << gs.invCount << "):\n";
+	if (gs.invCount == 0) { out << " - Empty -\n"; return; }
+	for (int i = 0; i < gs.invCount; ++i) {
+		out << (i + 1) << ". " << itemNames[gs.inventory[i]] << "\n";
 	}
 }
 
-int findInventoryIndex(const char* name) {
-	if (!name) return -1;
-	string target = toLowerTrim(string(name));
-	for (int i = 0; i < invCount; ++i) {
-		if (toLowerTrim(string(inventory[i])) == target) return i;
+void removeInventoryAt(GameSession &gs, int idx) {
+	if (idx < 0 || idx >= gs.invCount) return;
+	int itemId = gs.inventory[idx];
+	for (int i = idx; i < gs.invCount - 1; ++i) gs.inventory[i] = gs.inventory[i + 1];
+	--gs.invCount;
+	// two objects may give the same item: keep the bit while a copy is left
+	bool stillHeld = false;
+	for (int i = 0; i < gs.invCount && !stillHeld; ++i) stillHeld = gs.inventory[i] == itemId;
+	if (!stillHeld) gs.itemHeldBits[itemId >> 5] &= ~(1u << (itemId & 31));
+	int32_t slot = idx;
+	journalRecord(gs, JR_ITEM_REMOVE, &slot, sizeof(slot));
+}
+
+/* ========== Solved state ========== */
+
+int solvedWordCount() {
+	return (totalObjects + 31) / 32;
+}
+
+bool isObjectSolved(GameSession &gs, int pos) {
+	return (gs.objectSolvedBits[pos >> 5] >> (pos & 31)) & 1u;
+}
+
+// Marks an object of room 'roomIdx' solved, keeping the room's unsolved count in step.
+void markObjectSolved(GameSession &gs, int roomIdx, int pos) {
+	unsigned int bit = 1u << (pos & 31);
+	if (gs.objectSolvedBits[pos >> 5] & bit) return;
+	gs.objectSolvedBits[pos >> 5] |= bit;
+	--gs.roomUnsolvedCount[roomIdx];
+	int32_t p = pos;
+	journalRecord(gs, JR_SOLVED, &p, sizeof(p));
+}
+
+void resetSolvedState(GameSession &gs) {
+	int words = solvedWordCount();
+	for (int i = 0; i < words; ++i) gs.objectSolvedBits[i] = 0;
+	for (int r = 0; r < totalRooms; ++r) gs.roomUnsolvedCount[r] = roomObjectCount[r];
+}
+
+// Rebuilds the per-room counts from the bits (after loading a save).
+void recountUnsolved(GameSession &gs) {
+	for (int r = 0; r < totalRooms; ++r) {
+		int start = roomObjectStart[r];
+		int unsolved = 0;
+		for (int i = 0; i < roomObjectCount[r]; ++i) if (!isObjectSolved(gs, start + i)) ++unsolved;
+		gs.roomUnsolvedCount[r] = unsolved;
 	}
-	return -1;
 }
 
-void removeInventoryAt(int idx) {
-	if (idx < 0 || idx >= invCount) return;
-	delete[] inventory[idx];
-	for (int i = idx; i < invCount - 1; ++i) inventory[i] = inventory[i + 1];
-	--invCount;
+shared_ptr<Catalog> liveCatalog();
+void bindCatalog(Catalog* c);
+void prepareIndexedCatalog();
+
+// Per-session tables sized for the live catalog, which the session keeps.
+bool allocSession(GameSession &gs) {
+	gs.catalog = liveCatalog();
+	bindCatalog(gs.catalog.get());
+	prepareIndexedCatalog();
+	gs.objectSolvedBits = new(nothrow) unsigned int[solvedWordCount() > 0 ? solvedWordCount() : 1];
+	gs.roomUnsolvedCount = new(nothrow) int[totalRooms];
+	gs.puzzleSource = new(nothrow) int[totalObjects > 0 ? totalObjects : 1];
+	gs.itemHeldBits = new(nothrow) unsigned int[itemWordCount() > 0 ? itemWordCount() : 1];
+	if (!gs.objectSolvedBits || !gs.roomUnsolvedCount || !gs.puzzleSource || !gs.itemHeldBits) { cerr << "Memory alloc failed\n"; return false; }
+	resetSolvedState(gs);
+	clearInventory(gs);
+	for (int i = 0; i < totalObjects; ++i) gs.puzzleSource[i] = i;
+	return true;
+}
+
+void freeSession(GameSession &gs) {
+	if (gs.objectSolvedBits) { delete[] gs.objectSolvedBits; gs.objectSolvedBits = nullptr; }
+	if (gs.roomUnsolvedCount) { delete[] gs.roomUnsolvedCount; gs.roomUnsolvedCount = nullptr; }
+	if (gs.puzzleSource) { delete[] gs.puzzleSource; gs.puzzleSource = nullptr; }
+
+	// inventory
+	if (gs.inventory) { delete[] gs.inventory; gs.inventory = nullptr; }
+	if (gs.itemHeldBits) { delete[] gs.itemHeldBits; gs.itemHeldBits = nullptr; }
+	gs.invCount = 0; gs.invCapacity = 0;
+
+	// last summary arrays
+	if (gs.lastItemsCollected) { delete[] gs.lastItemsCollected; gs.lastItemsCollected = nullptr; }
+	gs.lastItemsCount = 0;
+	if (gs.lastAchievements) {
+		for (int i = 0; i < gs.lastAchievementsCount; ++i) delete[] gs.lastAchievements[i];
+		delete[] gs.lastAchievements; gs.lastAchievements = nullptr;
+	}
+	gs.lastAchievementsCount = 0;
+	gs.catalog.reset();
 }
 
 /* ========== File helper ========== */
@@ -256,885 +940,5503 @@ bool fileExists(const char* fname) {
 
 
 
-void freeAllMemory() {
+void releaseRoomPack();
+void releaseAnswerMatchers();
+void releaseItemDictionary();
+void releaseInteractionTable();
+void releaseRoomLayouts();
+void releaseLazyRooms();
+void captureCatalog(Catalog &c);
+void beginCatalog();
+shared_ptr<Catalog> finishCatalog(bool ok);
+void dropIndexedTables();
+
+// Frees the tables of the catalog bound on this thread, but not its text
+// (which a later version may still point into).
+void releaseCatalogTables() {
+	dropIndexedTables();
 	// rooms
-	if (roomNames) {
-		for (int i = 0; i < totalRooms; ++i) delete[] roomNames[i];
-		delete[] roomNames; roomNames = nullptr;
-	}
-	if (roomDescriptions) {
-		for (int i = 0; i < totalRooms; ++i) delete[] roomDescriptions[i];
-		delete[] roomDescriptions; roomDescriptions = nullptr;
-	}
+	if (roomNames) { delete[] roomNames; roomNames = nullptr; }
+	if (roomDescriptions) { delete[] roomDescriptions; roomDescriptions = nullptr; }
 	if (roomObjectCount) { delete[] roomObjectCount; roomObjectCount = nullptr; }
 	if (roomObjectStart) { delete[] roomObjectStart; roomObjectStart = nullptr; }
 
 	// objects
-	if (objectNames) {
-		for (int i = 0; i < totalObjects; ++i) delete[] objectNames[i];
-		delete[] objectNames; objectNames = nullptr;
-	}
-	if (objectDescriptions) {
-		for (int i = 0; i < totalObjects; ++i) delete[] objectDescriptions[i];
-		delete[] objectDescriptions; objectDescriptions = nullptr;
-	}
+	if (objectNames) { delete[] objectNames; objectNames = nullptr; }
+	if (objectDescriptions) { delete[] objectDescriptions; objectDescriptions = nullptr; }
 	if (objectHasPuzzle) { delete[] objectHasPuzzle; objectHasPuzzle = nullptr; }
 	if (objectPuzzleType) { delete[] objectPuzzleType; objectPuzzleType = nullptr; }
-	if (objectPuzzlePrompt) {
-		for (int i = 0; i < totalObjects; ++i) delete[] objectPuzzlePrompt[i];
-		delete[] objectPuzzlePrompt; objectPuzzlePrompt = nullptr;
-	}
-	if (objectPuzzleAnswer) {
-		for (int i = 0; i < totalObjects; ++i) delete[] objectPuzzleAnswer[i];
-		delete[] objectPuzzleAnswer; objectPuzzleAnswer = nullptr;
-	}
+	if (objectPuzzlePrompt) { delete[] objectPuzzlePrompt; objectPuzzlePrompt = nullptr; }
+	if (objectPuzzleAnswer) { delete[] objectPuzzleAnswer; objectPuzzleAnswer = nullptr; }
 	if (objectGivesItem) { delete[] objectGivesItem; objectGivesItem = nullptr; }
-	if (objectItemName) {
-		for (int i = 0; i < totalObjects; ++i) delete[] objectItemName[i];
-		delete[] objectItemName; objectItemName = nullptr;
-	}
-	if (objectSolved) { delete[] objectSolved; objectSolved = nullptr; }
+	if (objectItemName) { delete[] objectItemName; objectItemName = nullptr; }
 
-	// inventory
-	if (inventory) {
-		for (int i = 0; i < invCount; ++i) delete[] inventory[i];
-		delete[] inventory; inventory = nullptr;
-	}
-	invCount = 0; invCapacity = 0;
+	// item interactions
+	if (interactionItemName) { delete[] interactionItemName; interactionItemName = nullptr; }
+	if (interactionObject) { delete[] interactionObject; interactionObject = nullptr; }
+	if (interactionEffect) { delete[] interactionEffect; interactionEffect = nullptr; }
 
-	// last summary arrays
-	if (lastItemsCollected) {
-		for (int i = 0; i < lastItemsCount; ++i) delete[] lastItemsCollected[i];
-		delete[] lastItemsCollected; lastItemsCollected = nullptr;
-	}
-	lastItemsCount = 0;
-	if (lastAchievements) {
-		for (int i = 0; i < lastAchievementsCount; ++i) delete[] lastAchievements[i];
-		delete[] lastAchievements; lastAchievements = nullptr;
-	}
-	lastAchievementsCount = 0;
+	releaseAnswerMatchers();
+	releaseItemDictionary();
+	releaseInteractionTable();
+	releaseRoomLayouts();
+	vector<uint64_t>().swap(*roomHashes);
 
 	totalRooms = 0;
 	totalObjects = 0;
+	totalInteractions = 0;
 }
 
-bool loadRoomsFromFile(const char* fname) {
-	if (!fileExists(fname)) {
-		cout << "Rooms file '" << fname << "' not found.\n";
-		return false;
-	}
-	ifstream fin(fname);
-	if (!fin) { cout << "Unable to open rooms file.\n"; return false; }
+// Empties the catalog bound on this thread, text included.
+void freeAllMemory() {
+	releaseLazyRooms();
+	if (!boundCatalog) return;
+	releaseCatalogTables();
+	// catalog text lives in the arena or in a mapped rooms.bin
+	arenaRelease(catalogArena);
+	releaseRoomPack();
+	captureCatalog(*boundCatalog);
+}
 
-	string line;
-	// find first numeric non-empty line -> totalRooms
-	int foundTotal = 0;
-	while (getline(fin, line)) {
-		string t = trimStr(line);
-		if (t.size() == 0) continue;
-		bool alldigits = true;
-		for (size_t i = 0; i < t.size(); ++i) if (!isdigit((unsigned char)t[i])) { alldigits = false; break; }
-		if (alldigits) {
-			foundTotal = safeAtoi(t.c_str());
-			break;
-		}
-	}
-	if (foundTotal <= 0) {
-		cout << "Failed to find total rooms count in rooms file.\n";
-		fin.close();
-		return false;
-	}
-	totalRooms = foundTotal;
+/* ========== Memory-mapped rooms file ========== */
 
-	// allocate room arrays
-	roomNames = new(nothrow) char*[totalRooms];
-	roomDescriptions = new(nothrow) char*[totalRooms];
-	roomObjectCount = new(nothrow) int[totalRooms];
-	roomObjectStart = new(nothrow) int[totalRooms];
-	if (!roomNames || !roomDescriptions || !roomObjectCount || !roomObjectStart) { cerr << "Memory alloc failed\n"; fin.close(); freeAllMemory(); return false; }
-	for (int i = 0; i < totalRooms; ++i) {
-		roomNames[i] = allocEmptyCstr();
-		roomDescriptions[i] = allocEmptyCstr();
-		roomObjectCount[i] = 0;
-		roomObjectStart[i] = 0;
-	}
+struct MappedFile {
+	const char* data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE fileHandle;
+	HANDLE mapHandle;
+#else
+	int fd;
+#endif
+};
 
-	// Temp containers for objects
-	int tempCap = 128;
-	int tempCount = 0;
-	char** tempFields = new(nothrow) char*[tempCap]; // each is array of 7 cstrings
-	if (!tempFields) { cerr << "Memory alloc failed\n"; fin.close(); freeAllMemory(); return false; }
-	for (int i = 0; i < tempCap; ++i) tempFields[i] = nullptr;
-	int* tempRoomIndex = new(nothrow) int[tempCap];
-	if (!tempRoomIndex) { cerr << "Memory alloc failed\n"; fin.close(); freeAllMemory(); return false; }
+// Maps the whole file read-only or, with 'copyOnWrite', writable with private
+// pages that are never written back. An empty file maps to data=nullptr, size=0.
+bool mapFile(const char* fname, MappedFile &mf, bool copyOnWrite) {
+	mf.data = nullptr;
+	mf.size = 0;
+#ifdef _WIN32
+	mf.mapHandle = NULL;
+	mf.fileHandle = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (mf.fileHandle == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER sz;
+	if (!GetFileSizeEx(mf.fileHandle, &sz)) { CloseHandle(mf.fileHandle); mf.fileHandle = INVALID_HANDLE_VALUE; return false; }
+	if (sz.QuadPart == 0) return true;
+	mf.mapHandle = CreateFileMappingA(mf.fileHandle, NULL, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+	if (!mf.mapHandle) { CloseHandle(mf.fileHandle); mf.fileHandle = INVALID_HANDLE_VALUE; return false; }
+	void* p = MapViewOfFile(mf.mapHandle, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+	if (!p) { CloseHandle(mf.mapHandle); CloseHandle(mf.fileHandle); mf.mapHandle = NULL; mf.fileHandle = INVALID_HANDLE_VALUE; return false; }
+	mf.data = (const char*)p;
+	mf.size = (size_t)sz.QuadPart;
+#else
+	mf.fd = open(fname, O_RDONLY);
+	if (mf.fd < 0) return false;
+	struct stat st;
+	if (fstat(mf.fd, &st) != 0) { close(mf.fd); mf.fd = -1; return false; }
+	if (st.st_size == 0) return true;
+	void* p = mmap(nullptr, (size_t)st.st_size, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, mf.fd, 0);
+	if (p == MAP_FAILED) { close(mf.fd); mf.fd = -1; return false; }
+	if (!copyOnWrite) madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+	mf.data = (const char*)p;
+	mf.size = (size_t)st.st_size;
+#endif
+	return true;
+}
 
-	// rewind and skip first numeric line
-	fin.clear();
-	fin.seekg(0, ios::beg);
-	while (getline(fin, line)) {
-		string t = trimStr(line);
-		if (t.size() == 0) continue;
-		bool alldigits = true;
-		for (size_t i = 0; i < t.size(); ++i) if (!isdigit((unsigned char)t[i])) { alldigits = false; break; }
-		if (alldigits) break;
-	}
+bool mapFileReadOnly(const char* fname, MappedFile &mf) {
+	return mapFile(fname, mf, false);
+}
 
-	int roomIndex = -1;
-	while (getline(fin, line)) {
-		string t = trimStr(line);
-		if (t.size() == 0) continue;
-		if (_stricmp(t.c_str(), "ROOM") == 0) {
-			roomIndex++;
-			if (roomIndex >= totalRooms) break;
-			// read room name
-			string rname = "";
-			while (getline(fin, line)) {
-				rname = trimStr(line);
-				if (rname.size() > 0) break;
-			}
-			if (rname.size() == 0) rname = string("Unnamed Room");
-			delete[] roomNames[roomIndex];
-			roomNames[roomIndex] = allocCstrFromStd(rname);
-			// description
-			string rdesc = "";
-			while (getline(fin, line)) {
-				rdesc = trimStr(line);
-				if (rdesc.size() > 0) break;
-			}
-			if (rdesc.size() == 0) rdesc = string(" ");
-			delete[] roomDescriptions[roomIndex];
-			roomDescriptions[roomIndex] = allocCstrFromStd(rdesc);
-
-			// OBJECTS n
-			int objCount = 0;
-			bool gotObjects = false;
-			while (getline(fin, line)) {
-				string tmp = trimStr(line);
-				if (tmp.size() == 0) continue;
-				string up = tmp;
-				for (size_t i = 0; i < up.size(); ++i) up[i] = toupper((unsigned char)up[i]);
-				if (up.rfind("OBJECTS", 0) == 0) {
-					size_t pos = tmp.find_first_of("0123456789");
-					if (pos != string::npos) {
-						string num = tmp.substr(pos);
-						objCount = safeAtoi(num.c_str());
-					}
-					else objCount = 0;
-					gotObjects = true;
-					break;
-				}
-				else {
-					// keep forgiving: if we encounter "OBJECT" treat it as start (but we expect OBJECTS)
-					if (_stricmp(tmp.c_str(), "OBJECT") == 0) {
-						gotObjects = true;
-						objCount = 0; // we'll just parse until ENDROOM if OBJECTS omitted (edge-case)
-						// put the stream pointer back logically is complicated; but Option B uses OBJECTS.
-						break;
-					}
-					else continue;
-				}
-			}
-			if (!gotObjects) objCount = 0;
-			roomObjectCount[roomIndex] = objCount;
-
-			// parse objects
-			for (int oi = 0; oi < objCount; ++oi) {
-				// find OBJECT token
-				string tok;
-				while (getline(fin, tok)) {
-					tok = trimStr(tok);
-					if (tok.size() == 0) continue;
-					if (_stricmp(tok.c_str(), "OBJECT") == 0) break;
-				}
-				string oName = "", oDesc = "", pTypeStr = "0", pPrompt = "NOPROMPT", pAnswer = "NOANSWER", givesItemStr = "0", itemNameStr = "NOITEM";
-				// name
-				while (getline(fin, line)) { oName = trimStr(line); if (oName.size() > 0) break; }
-				if (oName.size() == 0) oName = string("Unnamed Object");
-				// desc
-				while (getline(fin, line)) { oDesc = trimStr(line); if (oDesc.size() > 0) break; }
-				if (oDesc.size() == 0) oDesc = string(" ");
-				// puzzle type
-				while (getline(fin, line)) { pTypeStr = trimStr(line); if (pTypeStr.size() > 0) break; }
-				if (pTypeStr.size() == 0) pTypeStr = string("0");
-				// prompt
-				while (getline(fin, line)) { pPrompt = trimStr(line); if (pPrompt.size() > 0) break; }
-				if (pPrompt.size() == 0) pPrompt = string("NOPROMPT");
-				// answer
-				while (getline(fin, line)) { pAnswer = trimStr(line); if (pAnswer.size() > 0) break; }
-				if (pAnswer.size() == 0) pAnswer = string("NOANSWER");
-				// gives item
-				while (getline(fin, line)) { givesItemStr = trimStr(line); if (givesItemStr.size() > 0) break; }
-				if (givesItemStr.size() == 0) givesItemStr = string("0");
-				// item name
-				while (getline(fin, line)) { itemNameStr = trimStr(line); if (itemNameStr.size() > 0) break; }
-				if (itemNameStr.size() == 0) itemNameStr = string("NOITEM");
-
-				if (tempCount >= tempCap) {
-					int newCap = tempCap * 2;
-					char** nf = new(nothrow) char*[newCap];
-					if (!nf) { cerr << "Memory alloc failed\n"; fin.close(); freeAllMemory(); return false; }
-					for (int k = 0; k < tempCount; ++k) nf[k] = tempFields[k];
-					for (int k = tempCount; k < newCap; ++k) nf[k] = nullptr;
-					delete[] tempFields;
-					tempFields = nf;
-					int* newRooms = new(nothrow) int[newCap];
-					if (!newRooms) { cerr << "Memory alloc failed\n"; fin.close(); freeAllMemory(); return false; }
-					for (int k = 0; k < tempCount; ++k) newRooms[k] = tempRoomIndex[k];
-					delete[] tempRoomIndex;
-					tempRoomIndex = newRooms;
-					tempCap = newCap;
-				}
-				char** fields = new(nothrow) char*[7];
-				fields[0] = allocCstrFromStd(oName);
-				fields[1] = allocCstrFromStd(oDesc);
-				fields[2] = allocCstrFromStd(pTypeStr);
-				fields[3] = allocCstrFromStd(pPrompt);
-				fields[4] = allocCstrFromStd(pAnswer);
-				fields[5] = allocCstrFromStd(givesItemStr);
-				fields[6] = allocCstrFromStd(itemNameStr);
-				tempFields[tempCount] = fields;
-				tempRoomIndex[tempCount] = roomIndex;
-				++tempCount;
-			} // end objects for room
-		} // end ROOM token branch
-		else {
-			// skip unknown
-		}
+void unmapFile(MappedFile &mf) {
+#ifdef _WIN32
+	if (mf.data) UnmapViewOfFile(mf.data);
+	if (mf.mapHandle) CloseHandle(mf.mapHandle);
+	if (mf.fileHandle != INVALID_HANDLE_VALUE) CloseHandle(mf.fileHandle);
+	mf.mapHandle = NULL;
+	mf.fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (mf.data) munmap((void*)mf.data, mf.size);
+	if (mf.fd >= 0) close(mf.fd);
+	mf.fd = -1;
+#endif
+	mf.data = nullptr;
+	mf.size = 0;
+}
+
+/* ========== Rooms file tokenizer ========== */
+
+// Forward-only cursor over the mapped text. Lines are handed out as trimmed
+// (pointer, length) spans into the mapping; nothing is copied.
+struct TextCursor {
+	const char* p;
+	const char* end;
+};
+
+bool nextLine(TextCursor &c, const char* &s, size_t &n) {
+	if (c.p >= c.end) return false;
+	splitLine(c.p, c.end, s, n, c.p);
+	return true;
+}
+
+// nextLine with the byte loops only (the --bench-text baseline).
+bool nextLineScalar(TextCursor &c, const char* &s, size_t &n) {
+	if (c.p >= c.end) return false;
+	const char* nl = (const char*)memchr(c.p, '\n', (size_t)(c.end - c.p));
+	const char* le = nl ? nl : c.end;
+	s = c.p + skipSpacesScalar(c.p, (size_t)(le - c.p));
+	n = trimSpacesEndScalar(s, (size_t)(le - s));
+	c.p = nl ? nl + 1 : c.end;
+	return true;
+}
+
+bool nextNonEmptyLine(TextCursor &c, const char* &s, size_t &n) {
+	while (nextLine(c, s, n)) {
+		if (n > 0) return true;
 	}
-	fin.close();
+	return false;
+}
+
+// Case-insensitive compare of a span against a keyword (same as _stricmp == 0).
+bool spanIEquals(const char* s, size_t n, const char* kw) {
+	return strlen(kw) == n && foldedEquals(s, kw, n);
+}
+
+bool spanIStartsWith(const char* s, size_t n, const char* kw) {
+	size_t k = strlen(kw);
+	return k <= n && foldedEquals(s, kw, k);
+}
+
+void spanTrim(const char* &s, size_t &n) {
+	size_t st = skipSpaces(s, n);
+	s += st;
+	n = trimSpacesEnd(s, n - st);
+}
+
+bool spanAllDigits(const char* s, size_t n) {
+	return allDigits(s, n);
+}
+
+// Reads the next non-empty line as a field, falling back to 'def' at end of input.
+void readFieldLine(TextCursor &c, const char* &s, size_t &n, const char* def) {
+	if (!nextNonEmptyLine(c, s, n)) { s = def; n = strlen(def); }
+}
+
+/* ========== Rooms loader ========== */
+
+// Bytes held by the per-room and per-object arrays (excluding the text).
+size_t catalogTableBytes() {
+	return (size_t)totalRooms * (2 * sizeof(char*) + 2 * sizeof(int))
+		+ (size_t)totalObjects * (5 * sizeof(char*) + 3 * sizeof(int))
+		+ (size_t)totalInteractions * (sizeof(char*) + 2 * sizeof(int));
+}
+
+void growIntArray(int* &arr, int count, int newCap) {
+	int* tmp = new(nothrow) int[newCap];
+	if (!tmp) { cerr << "Memory alloc failed\n"; exit(1); }
+	for (int i = 0; i < count; ++i) tmp[i] = arr[i];
+	delete[] arr;
+	arr = tmp;
+}
+
+void growCstrArray(char** &arr, int count, int newCap) {
+	char** tmp = new(nothrow) char*[newCap];
+	if (!tmp) { cerr << "Memory alloc failed\n"; exit(1); }
+	for (int i = 0; i < count; ++i) tmp[i] = arr[i];
+	delete[] arr;
+	arr = tmp;
+}
+
+void ensureObjectCapacity(int needed, int &cap) {
+	if (needed <= cap) return;
+	int newCap = cap > 0 ? cap : 16;
+	while (newCap < needed) newCap *= 2;
+	growCstrArray(objectNames, totalObjects, newCap);
+	growCstrArray(objectDescriptions, totalObjects, newCap);
+	growIntArray(objectHasPuzzle, totalObjects, newCap);
+	growIntArray(objectPuzzleType, totalObjects, newCap);
+	growCstrArray(objectPuzzlePrompt, totalObjects, newCap);
+	growCstrArray(objectPuzzleAnswer, totalObjects, newCap);
+	growIntArray(objectGivesItem, totalObjects, newCap);
+	growCstrArray(objectItemName, totalObjects, newCap);
+	cap = newCap;
+}
+
+// What using an item on an object does.
+enum UseEffect { USE_UNLOCK = 1, USE_CONSUME = 2 };
+
+void ensureInteractionCapacity(int needed, int &cap) {
+	if (needed <= cap) return;
+	int newCap = cap > 0 ? cap : 8;
+	while (newCap < needed) newCap *= 2;
+	growCstrArray(interactionItemName, totalInteractions, newCap);
+	growIntArray(interactionObject, totalInteractions, newCap);
+	growIntArray(interactionEffect, totalInteractions, newCap);
+	cap = newCap;
+}
+
+// "USE <item> ON <object> = UNLOCK [CONSUME]" after a room's objects. ON must be
+// upper case so it can appear inside names; the object is looked up in the room.
+void parseInteractionLine(int roomIndex, const char* s, size_t n, int &cap) {
+	const char* line = s;
+	size_t lineLen = n;
+	size_t on = 0, eq = 0;
+	for (size_t i = 4; i + 4 <= n && on == 0; ++i) if (memcmp(s + i, " ON ", 4) == 0) on = i;
+	for (size_t i = on; i < n && eq == 0; ++i) if (s[i] == '=') eq = i;
+	const char* item = s + 4;
+	size_t itemLen = on > 4 ? on - 4 : 0;
+	const char* obj = s + on + 4;
+	size_t objLen = eq > on + 4 ? eq - on - 4 : 0;
+	spanTrim(item, itemLen);
+	spanTrim(obj, objLen);
+	int effect = 0;
+	bool valid = on > 0 && eq > 0 && itemLen > 0 && objLen > 0;
+	for (size_t i = eq + 1; valid && i < n; ) {
+		while (i < n && isspace((unsigned char)s[i])) ++i;
+		size_t st = i;
+		while (i < n && !isspace((unsigned char)s[i])) ++i;
+		if (i == st) break;
+		if (spanIEquals(s + st, i - st, "UNLOCK")) effect |= USE_UNLOCK;
+		else if (spanIEquals(s + st, i - st, "CONSUME")) effect |= USE_CONSUME;
+		else valid = false;
+	}
+	int pos = -1;
+	for (int i = 0; valid && i < roomObjectCount[roomIndex] && pos < 0; ++i) {
+		if (spanIEquals(obj, objLen, objectNames[roomObjectStart[roomIndex] + i])) pos = roomObjectStart[roomIndex] + i;
+	}
+	if (!valid || effect == 0 || pos < 0) {
+		cout << "Room '" << roomNames[roomIndex] << "': ignoring '" << string(line, lineLen) << "'.\n";
+		return;
+	}
+	ensureInteractionCapacity(totalInteractions + 1, cap);
+	interactionItemName[totalInteractions] = arenaCopy(catalogArena, item, itemLen);
+	interactionObject[totalInteractions] = pos;
+	interactionEffect[totalInteractions] = effect;
+	++totalInteractions;
+}
+
+// Where a room's text is in rooms.txt: from its ROOM line up to the next
+// one. Recorded by the full parse and saved in rooms.idx for lazy loading.
+struct RoomBlock {
+	uint64_t offset = 0;
+	uint32_t length = 0;
+	int32_t objectStart = 0;
+	int32_t objectCount = 0;
+	uint32_t reserved = 0;  // keeps the padding written to rooms.idx zeroed
+};
+
+// Filled by the parse on the loading thread; the lazy console keeps them.
+thread_local vector<RoomBlock> roomBlocks;
+bool hashRoomText = false; // --watch: fill roomHashes while the file is mapped
+
+// Hash of a room's block, eight bytes a step; only compared between catalog versions.
+uint64_t roomTextHash(const char* p, size_t n) {
+	uint64_t h = 0x9E3779B97F4A7C15ull ^ n;
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		uint64_t w;
+		memcpy(&w, p + i, 8);
+		h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+		h ^= h >> 32;
+	}
+	uint64_t w = 0;
+	memcpy(&w, p + i, n - i);
+	h = (h ^ w) * 0xC4CEB9FE1A85EC53ull;
+	return h ^ (h >> 29);
+}
+
+// Reads up to a room's "OBJECTS n" line and returns n (a bare OBJECT token is
+// tolerated and means no counted objects).
+int readObjectCount(TextCursor &cur) {
+	const char* s = nullptr;
+	size_t n = 0;
+	while (nextNonEmptyLine(cur, s, n)) {
+		if (spanIStartsWith(s, n, "OBJECTS")) {
+			size_t pos = 0;
+			while (pos < n && !isdigit((unsigned char)s[pos])) ++pos;
+			return pos < n ? safeAtoiSpan(s + pos, n - pos) : 0;
+		}
+		if (spanIEquals(s, n, "OBJECT")) break;
+	}
+	return 0;
+}
+
+// Parses a room after its ROOM line: name, description, "OBJECTS n" and the
+// objects, stored from object index 'first' on with the text in 'arena'.
+// The full parse grows the object arrays through 'objCap'; lazy and parallel
+// loading pass nullptr and the known count as 'maxObjects'. Returns the
+// number of objects read.
+int parseRoomBody(StringArena &arena, TextCursor &cur, int roomIndex, int first, int maxObjects, int* objCap) {
+	const char* s = nullptr;
+	size_t n = 0;
+	readFieldLine(cur, s, n, "Unnamed Room");
+	roomNames[roomIndex] = arenaCopy(arena, s, n);
+	readFieldLine(cur, s, n, " ");
+	roomDescriptions[roomIndex] = arenaCopy(arena, s, n);
+
+	int objCount = readObjectCount(cur);
+	if (objCount > maxObjects) objCount = maxObjects;
+	roomObjectStart[roomIndex] = first;
+	roomObjectCount[roomIndex] = objCount;
+	if (objCap && objCount > 0) ensureObjectCapacity(first + objCount, *objCap);
+
+	for (int oi = 0; oi < objCount; ++oi) {
+		// find OBJECT token
+		while (nextNonEmptyLine(cur, s, n)) {
+			if (spanIEquals(s, n, "OBJECT")) break;
+		}
+		int pos = first + oi;
+		readFieldLine(cur, s, n, "Unnamed Object");
+		objectNames[pos] = arenaCopy(arena, s, n);
+		readFieldLine(cur, s, n, " ");
+		objectDescriptions[pos] = arenaCopy(arena, s, n);
+		readFieldLine(cur, s, n, "0");
+		int ptype = safeAtoiSpan(s, n);
+		objectPuzzleType[pos] = ptype;
+		objectHasPuzzle[pos] = (ptype != 0) ? 1 : 0;
+		readFieldLine(cur, s, n, "NOPROMPT");
+		if (spanIEquals(s, n, "NOPROMPT")) n = 0;
+		objectPuzzlePrompt[pos] = arenaCopy(arena, s, n);
+		readFieldLine(cur, s, n, "NOANSWER");
+		if (spanIEquals(s, n, "NOANSWER")) n = 0;
+		objectPuzzleAnswer[pos] = arenaCopy(arena, s, n);
+		readFieldLine(cur, s, n, "0");
+		objectGivesItem[pos] = (spanIEquals(s, n, "1") || spanIEquals(s, n, "YES")) ? 1 : 0;
+		readFieldLine(cur, s, n, "NOITEM");
+		if (spanIEquals(s, n, "NOITEM")) n = 0;
+		objectItemName[pos] = arenaCopy(arena, s, n);
+	}
+	return objCount;
+}
+
+/* ========== Parallel rooms parse ========== */
+
+// Large files are cut on ROOM lines and the rooms parsed on several threads:
+// each thread finds the ROOM lines in its byte range, then counts the objects
+// of its rooms; a prefix sum over the counts gives roomObjectStart, and each
+// thread fills its rooms' slice of the object arrays with the text in its own
+// arena. A ROOM line can also be a field value (a room named "Room"), so a
+// room whose fields run past the next ROOM line means the cut was wrong and
+// the file is parsed serially instead.
+int parseThreads = 0; // --parse-threads=N; 0 = one per core
+const size_t PARALLEL_PARSE_MIN_BYTES = 1 << 20; // below this one thread is faster
+
+// Runs body(t) for t in [0, threads), one thread each (t = 0 on the caller).
+template <typename F>
+void runOnThreads(int threads, F body) {
+	vector<thread> pool;
+	for (int t = 1; t < threads; ++t) pool.push_back(thread(body, t));
+	body(0);
+	for (size_t t = 0; t < pool.size(); ++t) pool[t].join();
+}
+
+// Appends the trimmed start of every ROOM line that begins in [from, to).
+void findRoomLines(const char* base, const char* end, const char* from, const char* to, vector<const char*> &out) {
+	const char* p = from;
+	if (p > base && p[-1] != '\n') {
+		const char* nl = (const char*)memchr(p, '\n', (size_t)(end - p));
+		p = nl ? nl + 1 : end;
+	}
+	TextCursor c;
+	c.end = end;
+	const char* s = nullptr;
+	size_t n = 0;
+	while (p < to) {
+		c.p = p;
+		nextLine(c, s, n);
+		if (spanIEquals(s, n, "ROOM")) out.push_back(s);
+		p = c.p;
+	}
+}
+
+struct PendingUseLine {
+	int room;
+	const char* s;
+	size_t n;
+};
+
+// Finds the ROOM lines after 'cur' per byte range on 'threads' threads.
+// roomAt gets the first totalRooms of them plus the end of the last block;
+// returns how many rooms the file holds (at most totalRooms).
+int findRoomBlocks(const MappedFile &mf, const TextCursor &cur, int threads, vector<const char*> &roomAt) {
+	const char* base = mf.data;
+	const char* end = mf.data + mf.size;
+	size_t span = (size_t)(end - cur.p);
+	vector<vector<const char*>> found((size_t)threads);
+	runOnThreads(threads, [&](int t) {
+		const char* from = cur.p + span * t / threads;
+		const char* to = cur.p + span * (t + 1) / threads;
+		findRoomLines(base, end, from, to, found[t]);
+	});
+	roomAt.clear();
+	for (int t = 0; t < threads; ++t) roomAt.insert(roomAt.end(), found[t].begin(), found[t].end());
+	int rooms = (int)min<size_t>(roomAt.size(), (size_t)totalRooms);
+	// a room's block runs to the next ROOM line, even one past the last room read
+	roomAt.push_back(roomAt.size() > (size_t)rooms ? roomAt[rooms] : end);
+	if (roomAt.size() > (size_t)rooms + 1) roomAt.resize((size_t)rooms + 1);
+	return rooms;
+}
+
+// Parses the rooms after 'cur' (positioned past the room count line) with
+// 'threads' threads. Returns false, with the rooms reset to 'emptyText' and
+// no objects, when the file has to be parsed serially.
+bool parseRoomsParallel(const MappedFile &mf, TextCursor cur, int threads, char* emptyText, int &objCap, int &useCap) {
+	const char* base = mf.data;
+	const char* end = mf.data + mf.size;
+	size_t span = (size_t)(end - cur.p);
+
+	// 1. ROOM lines, found per byte range and concatenated in order
+	vector<const char*> roomAt;
+	int rooms = findRoomBlocks(mf, cur, threads, roomAt);
+
+	// rooms are dealt out in contiguous runs of about the same byte size
+	vector<int> firstRoom((size_t)threads + 1, rooms);
+	for (int t = 0; t < threads; ++t) {
+		const char* from = cur.p + span * t / threads;
+		firstRoom[t] = (int)(lower_bound(roomAt.begin(), roomAt.begin() + rooms, from) - roomAt.begin());
+	}
+
+	// 2. object counts, then their prefix sum
+	vector<int> counts((size_t)rooms, 0);
+	runOnThreads(threads, [&](int t) {
+		const char* s = nullptr;
+		size_t n = 0;
+		for (int r = firstRoom[t]; r < firstRoom[t + 1]; ++r) {
+			TextCursor c;
+			c.p = roomAt[r];
+			c.end = end;
+			nextLine(c, s, n); // ROOM
+			readFieldLine(c, s, n, "");
+			readFieldLine(c, s, n, "");
+			counts[r] = readObjectCount(c);
+		}
+	});
+	long long objects = 0;
+	for (int r = 0; r < rooms; ++r) {
+		roomObjectStart[r] = (int)objects;
+		roomObjectCount[r] = counts[r];
+		objects += counts[r];
+	}
+	if (objects > INT_MAX) return false;
+	if (objects > 0) ensureObjectCapacity((int)objects, objCap);
+
+	// 3. rooms and objects, each thread into its own slice and arena; the
+	// workers view the catalog being built through its stored arrays
+	Catalog* building = boundCatalog;
+	captureCatalog(*building);
+	vector<StringArena> arenas((size_t)threads, StringArena{ nullptr, 0, 0, ARENA_FIRST_BLOCK, 0, 0, 0 });
+	vector<vector<PendingUseLine>> uses((size_t)threads);
+	atomic<bool> misCut{ false };
+	runOnThreads(threads, [&](int t) {
+		if (t > 0) bindCatalog(building);
+		if (firstRoom[t] < firstRoom[t + 1])
+			arenas[t].nextBlockSize = (size_t)(roomAt[firstRoom[t + 1]] - roomAt[firstRoom[t]]) + 64;
+		const char* s = nullptr;
+		size_t n = 0;
+		for (int r = firstRoom[t]; r < firstRoom[t + 1] && !misCut.load(memory_order_relaxed); ++r) {
+			TextCursor c;
+			c.p = roomAt[r];
+			c.end = end;
+			nextLine(c, s, n); // ROOM
+			parseRoomBody(arenas[t], c, r, roomObjectStart[r], counts[r], nullptr);
+			if (c.p > roomAt[r + 1]) { misCut.store(true, memory_order_relaxed); break; }
+			c.end = roomAt[r + 1];
+			while (nextNonEmptyLine(c, s, n)) {
+				if (spanIStartsWith(s, n, "USE ")) uses[t].push_back(PendingUseLine{ r, s, n });
+			}
+		}
+	});
+	if (misCut.load()) {
+		for (int t = 0; t < threads; ++t) arenaRelease(arenas[t]);
+		for (int r = 0; r < totalRooms; ++r) {
+			roomNames[r] = emptyText;
+			roomDescriptions[r] = emptyText;
+			roomObjectCount[r] = 0;
+			roomObjectStart[r] = 0;
+		}
+		return false;
+	}
+	for (int t = 0; t < threads; ++t) arenaAdopt(catalogArena, arenas[t]);
+	totalObjects = (int)objects;
+
+	// interactions look objects up by name and are few; they stay serial
+	for (int t = 0; t < threads; ++t)
+		for (size_t k = 0; k < uses[t].size(); ++k) parseInteractionLine(uses[t][k].room, uses[t][k].s, uses[t][k].n, useCap);
+
+	roomBlocks.assign((size_t)totalRooms, RoomBlock());
+	for (int r = 0; r < rooms; ++r) {
+		roomBlocks[r].offset = (uint64_t)(roomAt[r] - base);
+		roomBlocks[r].length = (uint32_t)(roomAt[r + 1] - roomAt[r]);
+		roomBlocks[r].objectStart = roomObjectStart[r];
+		roomBlocks[r].objectCount = roomObjectCount[r];
+	}
+	for (int r = rooms; r < totalRooms; ++r) roomObjectStart[r] = roomBlocks[r].objectStart = totalObjects;
+	return true;
+}
+
+// Fills roomHashes from roomBlocks; rooms missing from the file hash to 0.
+void hashRoomBlocks(const char* base, int threads) {
+	roomHashes->assign((size_t)totalRooms, 0);
+	uint64_t* out = roomHashes.data();
+	const RoomBlock* blocks = roomBlocks.data();
+	int rooms = totalRooms;
+	runOnThreads(threads, [&](int t) {
+		for (int r = (int)((long long)rooms * t / threads); r < (int)((long long)rooms * (t + 1) / threads); ++r)
+			if (blocks[r].length > 0) out[r] = roomTextHash(base + blocks[r].offset, blocks[r].length);
+	});
+}
+
+// The first numeric non-empty line: the number of rooms.
+int readRoomCount(TextCursor &cur) {
+	const char* s = nullptr;
+	size_t n = 0;
+	while (nextNonEmptyLine(cur, s, n)) {
+		if (spanAllDigits(s, n)) return safeAtoiSpan(s, n);
+	}
+	return 0;
+}
+
+// Single forward pass over the mapped file (or the parallel parse above for
+// large files). Fields are tokenized as spans and written straight into the
+// final room/object arrays; objects are appended in room order, so
+// roomObjectStart is the running object count.
+bool loadRoomsFromFile(const char* fname) {
+	if (!fileExists(fname)) {
+		cout << "Rooms file '" << fname << "' not found.\n";
+		return false;
+	}
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	MappedFile mf;
+	if (!mapFileReadOnly(fname, mf)) { cout << "Unable to open rooms file.\n"; return false; }
+
+	TextCursor cur;
+	cur.p = mf.data;
+	cur.end = mf.data + mf.size;
+	const char* s = nullptr;
+	size_t n = 0;
+
+	int foundTotal = readRoomCount(cur);
+	if (foundTotal <= 0) {
+		cout << "Failed to find total rooms count in rooms file.\n";
+		unmapFile(mf);
+		return false;
+	}
+
+	// allocate room arrays
+	roomNames = new(nothrow) char*[foundTotal];
+	roomDescriptions = new(nothrow) char*[foundTotal];
+	roomObjectCount = new(nothrow) int[foundTotal];
+	roomObjectStart = new(nothrow) int[foundTotal];
+	if (!roomNames || !roomDescriptions || !roomObjectCount || !roomObjectStart) { cerr << "Memory alloc failed\n"; unmapFile(mf); freeAllMemory(); return false; }
+	totalRooms = foundTotal;
+	int threads = parseThreads > 0 ? parseThreads : (int)thread::hardware_concurrency();
+	if (threads < 1 || mf.size < PARALLEL_PARSE_MIN_BYTES) threads = 1;
+	// the text can't outgrow the file, so one block usually holds the catalog
+	// (the parallel parse sizes its per-thread arenas instead)
+	if (catalogArena.block == nullptr && threads == 1) catalogArena.nextBlockSize = mf.size + 64;
+	char* emptyText = arenaCopy(catalogArena, "", 0);
+	for (int i = 0; i < totalRooms; ++i) {
+		roomNames[i] = emptyText;
+		roomDescriptions[i] = emptyText;
+		roomObjectCount[i] = 0;
+		roomObjectStart[i] = 0;
+	}
+
+	int objCap = 0;
+	int useCap = 0;
+	if (threads > 1 && !parseRoomsParallel(mf, cur, threads, emptyText, objCap, useCap)) threads = 1;
+	int roomIndex = -1;
+	if (threads == 1) roomBlocks.assign((size_t)totalRooms, RoomBlock());
+	while (threads == 1 && nextNonEmptyLine(cur, s, n)) {
+		if (roomIndex >= 0 && spanIStartsWith(s, n, "USE ")) { parseInteractionLine(roomIndex, s, n, useCap); continue; }
+		if (!spanIEquals(s, n, "ROOM")) continue; // skip unknown
+		uint64_t at = (uint64_t)(s - mf.data);
+		if (roomIndex >= 0) roomBlocks[roomIndex].length = (uint32_t)(at - roomBlocks[roomIndex].offset);
+		roomIndex++;
+		if (roomIndex >= totalRooms) break;
+		roomBlocks[roomIndex].offset = at;
+		totalObjects += parseRoomBody(catalogArena, cur, roomIndex, totalObjects, INT_MAX, &objCap);
+		roomBlocks[roomIndex].objectStart = roomObjectStart[roomIndex];
+		roomBlocks[roomIndex].objectCount = roomObjectCount[roomIndex];
+	}
+	if (roomIndex >= 0 && roomIndex < totalRooms) roomBlocks[roomIndex].length = (uint32_t)(mf.size - roomBlocks[roomIndex].offset);
+	if (hashRoomText) hashRoomBlocks(mf.data, threads);
+	unmapFile(mf);
+	// rooms missing from the file are empty and start after the last object
+	if (threads == 1)
+		for (int r = roomIndex + 1; r < totalRooms; ++r) roomObjectStart[r] = roomBlocks[r].objectStart = totalObjects;
+
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+	char msbuf[32]; sprintf_s(msbuf, "%.2f", ms);
+	cout << "Loaded " << totalRooms << " rooms and " << totalObjects << " objects in " << msbuf << " ms";
+	if (threads > 1) cout << " on " << threads << " threads";
+	cout << ".\n";
+	cout << "Catalog memory: " << catalogArena.bytesUsed << " bytes of text in " << catalogArena.blockCount << " arena block(s) ("
+		<< catalogArena.bytesReserved << " reserved), " << catalogTableBytes() << " bytes of tables.\n";
+	return true;
+}
+
+/* ========== Binary room pack (rooms.bin) ========== */
+
+// rooms.bin is rooms.txt compiled ahead of time (--compile-pack). Layout, all
+// little-endian and 4-byte aligned:
+//   PackHeader
+//   PackRoom[roomCount]
+//   PackObject[objectCount]
+//   PackInteraction[interactionCount]
+//   string table: NUL-terminated strings referenced by offset (offset 0 is "")
+// The file is mapped read-only and the catalog arrays point into the string
+// table, so processes sharing a host share one page-cache copy of the text.
+const char PACK_MAGIC[4] = { 'E', 'R', 'P', 'K' };
+const uint32_t PACK_VERSION = 2; // 2 added the item interactions
+
+struct PackHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t roomCount;
+	uint32_t objectCount;
+	uint32_t roomsOffset;
+	uint32_t objectsOffset;
+	uint32_t stringsOffset;
+	uint32_t stringsSize;
+	int64_t sourceSize;  // rooms.txt the pack was built from, for staleness checks
+	int64_t sourceMtime;
+	uint32_t interactionCount;
+	uint32_t interactionsOffset;
+};
+
+struct PackRoom {
+	uint32_t nameOff;
+	uint32_t descOff;
+	int32_t objectStart;
+	int32_t objectCount;
+};
+
+struct PackObject {
+	uint32_t nameOff;
+	uint32_t descOff;
+	uint32_t promptOff;
+	uint32_t answerOff;
+	uint32_t itemNameOff;
+	int32_t puzzleType;
+	int32_t givesItem;
+};
+
+struct PackInteraction {
+	uint32_t itemNameOff;
+	int32_t object;
+	int32_t effect;
+};
+
+thread_local MappedFile catalogPack;
+thread_local bool catalogPackMapped = false;
+
+void releaseRoomPack() {
+	if (catalogPackMapped) unmapFile(catalogPack);
+	catalogPackMapped = false;
+}
+
+// mtime is in nanoseconds, so an edit that keeps the size within the same
+// second still shows up.
+bool statFile(const char* fname, int64_t &size, int64_t &mtime) {
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA fa;
+	if (!GetFileAttributesExA(fname, GetFileExInfoStandard, &fa)) return false;
+	size = ((int64_t)fa.nFileSizeHigh << 32) | fa.nFileSizeLow;
+	mtime = (((int64_t)fa.ftLastWriteTime.dwHighDateTime << 32) | fa.ftLastWriteTime.dwLowDateTime) * 100;
+#else
+	struct stat st;
+	if (stat(fname, &st) != 0) return false;
+	size = (int64_t)st.st_size;
+#ifdef __APPLE__
+	mtime = (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+	mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+#endif
+	return true;
+}
+
+// Adds a string to the pack string table once and returns its offset.
+uint32_t packString(vector<char> &table, unordered_map<string, uint32_t> &seen, const char* s) {
+	string key(s);
+	unordered_map<string, uint32_t>::iterator it = seen.find(key);
+	if (it != seen.end()) return it->second;
+	uint32_t off = (uint32_t)table.size();
+	table.insert(table.end(), key.begin(), key.end());
+	table.push_back('\0');
+	seen[key] = off;
+	return off;
+}
+
+bool replaceFile(const char* tmp, const char* dst);
+
+// Writes the pack beside 'packName' and renames it over the old one, which
+// other running games may still have mapped.
+bool writeRoomPack(const char* txtName, const char* packName) {
+	if (!loadRoomsFromFile(txtName)) return false;
+
+	vector<char> strings;
+	unordered_map<string, uint32_t> seen;
+	packString(strings, seen, "");
+	vector<PackRoom> rooms(totalRooms);
+	vector<PackObject> objects(totalObjects);
+	for (int r = 0; r < totalRooms; ++r) {
+		rooms[r].nameOff = packString(strings, seen, roomNames[r]);
+		rooms[r].descOff = packString(strings, seen, roomDescriptions[r]);
+		rooms[r].objectStart = roomObjectStart[r];
+		rooms[r].objectCount = roomObjectCount[r];
+	}
+	for (int i = 0; i < totalObjects; ++i) {
+		objects[i].nameOff = packString(strings, seen, objectNames[i]);
+		objects[i].descOff = packString(strings, seen, objectDescriptions[i]);
+		objects[i].promptOff = packString(strings, seen, objectPuzzlePrompt[i]);
+		objects[i].answerOff = packString(strings, seen, objectPuzzleAnswer[i]);
+		objects[i].itemNameOff = packString(strings, seen, objectItemName[i]);
+		objects[i].puzzleType = objectPuzzleType[i];
+		objects[i].givesItem = objectGivesItem[i];
+	}
+	vector<PackInteraction> interactions(totalInteractions);
+	for (int i = 0; i < totalInteractions; ++i) {
+		interactions[i].itemNameOff = packString(strings, seen, interactionItemName[i]);
+		interactions[i].object = interactionObject[i];
+		interactions[i].effect = interactionEffect[i];
+	}
+	while (strings.size() % 4 != 0) strings.push_back('\0');
+
+	uint64_t roomsBytes = (uint64_t)rooms.size() * sizeof(PackRoom);
+	uint64_t objectsBytes = (uint64_t)objects.size() * sizeof(PackObject);
+	uint64_t interactionsBytes = (uint64_t)interactions.size() * sizeof(PackInteraction);
+	uint64_t total = sizeof(PackHeader) + roomsBytes + objectsBytes + interactionsBytes + strings.size();
+	if (total > 0xFFFFFFFFull) { cout << "Room catalog is too large for a room pack.\n"; freeAllMemory(); return false; }
+
+	PackHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, PACK_MAGIC, 4);
+	h.version = PACK_VERSION;
+	h.roomCount = (uint32_t)totalRooms;
+	h.objectCount = (uint32_t)totalObjects;
+	h.roomsOffset = (uint32_t)sizeof(PackHeader);
+	h.objectsOffset = (uint32_t)(h.roomsOffset + roomsBytes);
+	h.interactionCount = (uint32_t)totalInteractions;
+	h.interactionsOffset = (uint32_t)(h.objectsOffset + objectsBytes);
+	h.stringsOffset = (uint32_t)(h.interactionsOffset + interactionsBytes);
+	h.stringsSize = (uint32_t)strings.size();
+	if (!statFile(txtName, h.sourceSize, h.sourceMtime)) { h.sourceSize = 0; h.sourceMtime = 0; }
+
+	string tmp = string(packName) + ".tmp";
+	ofstream fout(tmp.c_str(), ios::binary | ios::trunc);
+	if (!fout) { cout << "Unable to open '" << tmp << "' for writing.\n"; freeAllMemory(); return false; }
+	fout.write((const char*)&h, sizeof(h));
+	if (roomsBytes > 0) fout.write((const char*)rooms.data(), (streamsize)roomsBytes);
+	if (objectsBytes > 0) fout.write((const char*)objects.data(), (streamsize)objectsBytes);
+	if (interactionsBytes > 0) fout.write((const char*)interactions.data(), (streamsize)interactionsBytes);
+	fout.write(strings.data(), (streamsize)strings.size());
+	fout.close();
+	bool ok = !fout.fail() && replaceFile(tmp.c_str(), packName);
+	if (!ok) { cout << "Failed writing '" << packName << "'.\n"; remove(tmp.c_str()); freeAllMemory(); return false; }
+	cout << "Wrote " << packName << ": " << totalRooms << " rooms, " << totalObjects << " objects, " << totalInteractions << " item interactions, " << strings.size() << " bytes of strings.\n";
+	freeAllMemory();
+	return true;
+}
+
+// Escape.exe --compile-pack: the catalog is parsed only to be written out.
+bool compileRoomPack(const char* txtName, const char* packName) {
+	beginCatalog();
+	bool ok = writeRoomPack(txtName, packName);
+	finishCatalog(false);
+	return ok;
+}
+
+// Maps rooms.bin and points the catalog arrays into it. Returns false (and
+// leaves the catalog empty) if the pack is missing, invalid or older than
+// the rooms.txt it was compiled from.
+bool loadRoomsFromPack(const char* packName, const char* txtName) {
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	if (!mapFileReadOnly(packName, catalogPack)) { cout << "Unable to open room pack.\n"; return false; }
+	catalogPackMapped = true;
+	const char* base = catalogPack.data;
+	uint64_t size = catalogPack.size;
+
+	const PackHeader* h = (const PackHeader*)base;
+	if (size < sizeof(PackHeader) || memcmp(h->magic, PACK_MAGIC, 4) != 0 || h->version != PACK_VERSION) {
+		cout << "Room pack '" << packName << "' is invalid or from another version.\n";
+		releaseRoomPack();
+		return false;
+	}
+	int64_t srcSize = 0, srcMtime = 0;
+	if (statFile(txtName, srcSize, srcMtime) && (srcSize != h->sourceSize || srcMtime != h->sourceMtime)) {
+		cout << "Room pack '" << packName << "' is out of date with '" << txtName << "'.\n";
+		releaseRoomPack();
+		return false;
+	}
+	if (h->roomCount == 0 || h->roomCount > (uint32_t)INT_MAX || h->objectCount > (uint32_t)INT_MAX || h->interactionCount > (uint32_t)INT_MAX
+		|| h->roomsOffset % 4 != 0 || h->objectsOffset % 4 != 0 || h->interactionsOffset % 4 != 0
+		|| (uint64_t)h->roomsOffset + (uint64_t)h->roomCount * sizeof(PackRoom) > size
+		|| (uint64_t)h->objectsOffset + (uint64_t)h->objectCount * sizeof(PackObject) > size
+		|| (uint64_t)h->interactionsOffset + (uint64_t)h->interactionCount * sizeof(PackInteraction) > size
+		|| h->stringsSize == 0 || (uint64_t)h->stringsOffset + h->stringsSize > size
+		|| base[h->stringsOffset + h->stringsSize - 1] != '\0') {
+		cout << "Room pack '" << packName << "' is corrupted.\n";
+		releaseRoomPack();
+		return false;
+	}
+	const PackRoom* prooms = (const PackRoom*)(base + h->roomsOffset);
+	const PackObject* pobjs = (const PackObject*)(base + h->objectsOffset);
+	const PackInteraction* puses = (const PackInteraction*)(base + h->interactionsOffset);
+	char* strings = (char*)(base + h->stringsOffset);
+	uint32_t strSize = h->stringsSize;
+	int nRooms = (int)h->roomCount;
+	int nObjects = (int)h->objectCount;
+	int nInteractions = (int)h->interactionCount;
+
+	roomNames = new(nothrow) char*[nRooms];
+	roomDescriptions = new(nothrow) char*[nRooms];
+	roomObjectCount = new(nothrow) int[nRooms];
+	roomObjectStart = new(nothrow) int[nRooms];
+	objectNames = new(nothrow) char*[nObjects];
+	objectDescriptions = new(nothrow) char*[nObjects];
+	objectHasPuzzle = new(nothrow) int[nObjects];
+	objectPuzzleType = new(nothrow) int[nObjects];
+	objectPuzzlePrompt = new(nothrow) char*[nObjects];
+	objectPuzzleAnswer = new(nothrow) char*[nObjects];
+	objectGivesItem = new(nothrow) int[nObjects];
+	objectItemName = new(nothrow) char*[nObjects];
+	interactionItemName = new(nothrow) char*[nInteractions > 0 ? nInteractions : 1];
+	interactionObject = new(nothrow) int[nInteractions > 0 ? nInteractions : 1];
+	interactionEffect = new(nothrow) int[nInteractions > 0 ? nInteractions : 1];
+	if (!roomNames || !roomDescriptions || !roomObjectCount || !roomObjectStart
+		|| !objectNames || !objectDescriptions || !objectHasPuzzle || !objectPuzzleType || !objectPuzzlePrompt
+		|| !objectPuzzleAnswer || !objectGivesItem || !objectItemName
+		|| !interactionItemName || !interactionObject || !interactionEffect) {
+		cerr << "Memory alloc failed\n"; freeAllMemory(); return false;
+	}
+
+	bool valid = true;
+	for (int r = 0; r < nRooms && valid; ++r) {
+		const PackRoom &pr = prooms[r];
+		if (pr.nameOff >= strSize || pr.descOff >= strSize || pr.objectStart < 0 || pr.objectCount < 0
+			|| (int64_t)pr.objectStart + pr.objectCount > nObjects) { valid = false; break; }
+		roomNames[r] = strings + pr.nameOff;
+		roomDescriptions[r] = strings + pr.descOff;
+		roomObjectStart[r] = pr.objectStart;
+		roomObjectCount[r] = pr.objectCount;
+	}
+	for (int i = 0; i < nObjects && valid; ++i) {
+		const PackObject &po = pobjs[i];
+		if (po.nameOff >= strSize || po.descOff >= strSize || po.promptOff >= strSize
+			|| po.answerOff >= strSize || po.itemNameOff >= strSize) { valid = false; break; }
+		objectNames[i] = strings + po.nameOff;
+		objectDescriptions[i] = strings + po.descOff;
+		objectPuzzleType[i] = po.puzzleType;
+		objectHasPuzzle[i] = (po.puzzleType != 0) ? 1 : 0;
+		objectPuzzlePrompt[i] = strings + po.promptOff;
+		objectPuzzleAnswer[i] = strings + po.answerOff;
+		objectGivesItem[i] = po.givesItem ? 1 : 0;
+		objectItemName[i] = strings + po.itemNameOff;
+	}
+	for (int i = 0; i < nInteractions && valid; ++i) {
+		const PackInteraction &pu = puses[i];
+		if (pu.itemNameOff >= strSize || pu.object < 0 || pu.object >= nObjects) { valid = false; break; }
+		interactionItemName[i] = strings + pu.itemNameOff;
+		interactionObject[i] = pu.object;
+		interactionEffect[i] = pu.effect;
+	}
+	totalRooms = nRooms;
+	totalObjects = nObjects;
+	totalInteractions = nInteractions;
+	if (!valid) {
+		cout << "Room pack '" << packName << "' is corrupted.\n";
+		freeAllMemory();
+		return false;
+	}
+
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+	char msbuf[32]; sprintf_s(msbuf, "%.2f", ms);
+	cout << "Loaded " << totalRooms << " rooms and " << totalObjects << " objects in " << msbuf << " ms.\n";
+	cout << "Catalog memory: " << strSize << " bytes of text mapped from " << packName << ", " << catalogTableBytes() << " bytes of tables.\n";
+	return true;
+}
+
+/* ========== Answer matchers ========== */
+
+// Puzzle types and their answer field ('|' separates accepted answers):
+//   1  7|8          numbers, compared as integers
+//   2  rome|roma    text, case-insensitive, surrounding spaces ignored
+//   3  b|d          option labels (a-z, 0-9); "b", "B)" and "(b)" all pick b
+//   4  10..20|-5..0 inclusive number ranges
+//   5  colou?r      pattern over the whole answer: literals, ., [a-z], [^...],
+//                   \d \w \s, ( ), |, *, + and ?
+// Answers are compiled once when the catalog loads, so a check is a hash
+// probe, a range scan or one DFA pass over the input, and never allocates.
+enum PuzzleType { PT_NONE = 0, PT_NUMBER = 1, PT_TEXT = 2, PT_CHOICE = 3, PT_RANGE = 4, PT_PATTERN = 5 };
+
+const int PATTERN_MAX_STATES = 1024; // DFA states per pattern
+
+struct AnswerRange {
+	long long lo, hi;
+};
+
+// Pattern DFA: bytes map to classes, next[state * classes + class] is the
+// following state (-1 = no match possible).
+struct AnswerDfa {
+	unsigned char classOf[256];
+	int classes;
+	int start;
+	vector<int> next;
+	vector<unsigned char> accept;
+};
+
+struct AnswerMatcher {
+	int type;             // PuzzleType the answer was compiled as
+	int first, count;     // slice of answerRanges (numbers, ranges) or answerTexts (text)
+	uint64_t choices;     // bit per option label: a-z then 0-9
+	int dfa;              // index in answerDfas (patterns)
+	const char* sample;   // one accepted answer, for hints and bots
+};
+
+// Open-addressed set of (object, normalized text answer).
+struct AnswerEntry {
+	uint64_t hash;
+	int puzzle;           // -1 = empty slot
+	const char* text;     // lowercased and trimmed, in the catalog arena
+	int len;
+};
+
+thread_local CatalogVector<AnswerMatcher> answerMatchers; // per catalog object
+thread_local CatalogVector<AnswerRange> answerRanges;
+thread_local CatalogVector<AnswerDfa> answerDfas;
+thread_local CatalogVector<AnswerEntry> answerTable;
+
+struct AnswerText {
+	const char* text;
+	int len;
+};
+thread_local CatalogVector<AnswerText> answerTexts;   // every object's text answers, in matcher slices
+
+// Typo tolerance for text puzzles: edits allowed on Easy / Medium / Hard,
+// never more than (answer length - 1) / 2. --typos=off turns it off.
+bool typoTolerance = true;
+
+int typoAllowance(int difficulty) {
+	if (!typoTolerance) return 0;
+	return difficulty == 1 ? 2 : (difficulty == 2 ? 1 : 0);
+}
+
+void answerTrim(const char* s, size_t n, size_t &st, size_t &ed) {
+	st = 0; ed = n;
+	while (st < ed && isspace((unsigned char)s[st])) ++st;
+	while (ed > st && isspace((unsigned char)s[ed - 1])) --ed;
+}
+
+uint64_t answerHash(int puzzle, const char* s, size_t n) {
+	uint64_t h = 14695981039346656037ull ^ ((uint64_t)puzzle * 0x9E3779B97F4A7C15ull);
+	for (size_t i = 0; i < n; ++i) { h ^= (unsigned char)tolower((unsigned char)s[i]); h *= 1099511628211ull; }
+	return h;
+}
+
+bool parseAnswerNumber(const char* s, size_t n, long long &v) {
+	size_t st, ed;
+	answerTrim(s, n, st, ed);
+	bool neg = false;
+	if (st < ed && (s[st] == '-' || s[st] == '+')) { neg = s[st] == '-'; ++st; }
+	if (st >= ed || ed - st > 18) return false;
+	v = 0;
+	for (size_t i = st; i < ed; ++i) {
+		if (!isdigit((unsigned char)s[i])) return false;
+		v = v * 10 + (s[i] - '0');
+	}
+	if (neg) v = -v;
+	return true;
+}
+
+// Option label 0-25 for a-z, 26-35 for 0-9; -1 if the input is not one label.
+int choiceLabel(const char* s, size_t n) {
+	size_t st, ed;
+	answerTrim(s, n, st, ed);
+	if (st < ed && s[st] == '(') ++st;
+	while (ed > st && (s[ed - 1] == ')' || s[ed - 1] == '.' || s[ed - 1] == ':')) --ed;
+	if (ed - st != 1) return -1;
+	unsigned char c = (unsigned char)tolower((unsigned char)s[st]);
+	if (c >= 'a' && c <= 'z') return c - 'a';
+	if (c >= '0' && c <= '9') return 26 + (c - '0');
+	return -1;
+}
+
+// Adds one accepted answer; returns its stored text, or nullptr if it was listed twice.
+const char* addTextAnswer(int puzzle, const char* s, size_t n) {
+	uint64_t h = answerHash(puzzle, s, n);
+	size_t mask = answerTable.size() - 1;
+	size_t i = (size_t)h & mask;
+	while (answerTable[i].puzzle >= 0) {
+		const AnswerEntry &e = answerTable[i];
+		if (e.hash == h && e.puzzle == puzzle && e.len == (int)n && spanIEquals(s, n, e.text)) return nullptr;
+		i = (i + 1) & mask;
+	}
+	char* text = arenaCopy(catalogArena, s, n);
+	for (size_t k = 0; k < n; ++k) text[k] = (char)tolower((unsigned char)text[k]);
+	AnswerEntry &e = answerTable[i];
+	e.hash = h;
+	e.puzzle = puzzle;
+	e.text = text;
+	e.len = (int)n;
+	return text;
+}
+
+// Adds a text answer an earlier catalog version already normalized and
+// de-duplicated; the text is shared with that version.
+void addCompiledTextAnswer(int puzzle, const char* text, int len) {
+	uint64_t h = answerHash(puzzle, text, (size_t)len);
+	size_t mask = answerTable.size() - 1;
+	size_t i = (size_t)h & mask;
+	while (answerTable[i].puzzle >= 0) i = (i + 1) & mask;
+	AnswerEntry &e = answerTable[i];
+	e.hash = h;
+	e.puzzle = puzzle;
+	e.text = text;
+	e.len = len;
+}
+
+// Levenshtein distance between a pattern of at most 64 bytes and the
+// lowercased text, using Myers' bit-vector algorithm (Hyyro's formulation for
+// whole strings): one pass over the text, a few word operations per byte.
+// 'peq' holds the pattern's match masks and must be all zero for other bytes.
+int myersDistance(const uint64_t* peq, int m, const char* text, size_t n) {
+	uint64_t pv = ~0ull, mv = 0;
+	uint64_t last = 1ull << (m - 1);
+	int score = m;
+	for (size_t j = 0; j < n; ++j) {
+		uint64_t eq = peq[(unsigned char)tolower((unsigned char)text[j])];
+		uint64_t xv = eq | mv;
+		uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+		uint64_t ph = mv | ~(xh | pv);
+		uint64_t mh = pv & xh;
+		if (ph & last) ++score;
+		else if (mh & last) --score;
+		ph = (ph << 1) | 1; // row 0 of the table grows by one per text byte
+		mh <<= 1;
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+	}
+	return score;
+}
+
+// Match masks of one pattern, set on and cleared off a zeroed per-thread table.
+thread_local uint64_t myersPeq[256];
+
+int editDistance(const char* pattern, int m, const char* text, size_t n) {
+	if (m == 0) return (int)n;
+	for (int k = 0; k < m; ++k) myersPeq[(unsigned char)pattern[k]] |= 1ull << k;
+	int d = myersDistance(myersPeq, m, text, n);
+	for (int k = 0; k < m; ++k) myersPeq[(unsigned char)pattern[k]] = 0;
+	return d;
+}
+
+bool textAnswerMatches(int puzzle, const char* s, size_t n, int maxEdits) {
+	size_t st, ed;
+	answerTrim(s, n, st, ed);
+	uint64_t h = answerHash(puzzle, s + st, ed - st);
+	size_t mask = answerTable.size() - 1;
+	for (size_t i = (size_t)h & mask; answerTable[i].puzzle >= 0; i = (i + 1) & mask) {
+		const AnswerEntry &e = answerTable[i];
+		if (e.hash != h || e.puzzle != puzzle || e.len != (int)(ed - st)) continue;
+		size_t k = 0;
+		while (k < ed - st && tolower((unsigned char)s[st + k]) == (unsigned char)e.text[k]) ++k;
+		if (k == ed - st) return true;
+	}
+	if (maxEdits <= 0) return false;
+	const AnswerMatcher &m = answerMatchers[puzzle];
+	for (int k = m.first; k < m.first + m.count; ++k) {
+		const AnswerText &a = answerTexts[k];
+		int allowed = min(maxEdits, (a.len - 1) / 2);
+		if (allowed <= 0 || a.len > 64) continue;
+		if ((int)(ed - st) > a.len + allowed || (int)(ed - st) < a.len - allowed) continue;
+		if (editDistance(a.text, a.len, s + st, ed - st) <= allowed) return true;
+	}
+	return false;
+}
+
+bool dfaMatches(const AnswerDfa &d, const char* s, size_t n) {
+	size_t st, ed;
+	answerTrim(s, n, st, ed);
+	int state = d.start;
+	for (size_t i = st; i < ed && state >= 0; ++i) {
+		state = d.next[(size_t)state * d.classes + d.classOf[(unsigned char)tolower((unsigned char)s[i])]];
+	}
+	return state >= 0 && d.accept[state];
+}
+
+/* Pattern compiler: Thompson NFA, then subset construction into a DFA. */
+
+struct ByteSet {
+	uint64_t w[4];
+};
+
+inline void byteSetAdd(ByteSet &b, int c) { b.w[c >> 6] |= 1ull << (c & 63); }
+inline bool byteSetHas(const ByteSet &b, int c) { return (b.w[c >> 6] >> (c & 63)) & 1; }
+
+// set >= 0: consume a byte in sets[set] and go to out1; otherwise epsilon
+// moves to out1 and out2 (-1 = none).
+struct NfaNode {
+	int set;
+	int out1, out2;
+};
+
+struct PatFrag {
+	int start;
+	int end; // epsilon node with no exits yet
+};
+
+struct PatternCompiler {
+	const char* p;
+	size_t n;
+	size_t i;
+	bool ok;
+	vector<NfaNode> nodes;
+	vector<ByteSet> sets;
+};
+
+int patNode(PatternCompiler &pc, int set, int out1, int out2) {
+	NfaNode nd = { set, out1, out2 };
+	pc.nodes.push_back(nd);
+	return (int)pc.nodes.size() - 1;
+}
+
+PatFrag patConsume(PatternCompiler &pc, const ByteSet &b) {
+	pc.sets.push_back(b);
+	PatFrag f;
+	f.end = patNode(pc, -1, -1, -1);
+	f.start = patNode(pc, (int)pc.sets.size() - 1, f.end, -1);
+	return f;
+}
+
+// \d \w \s or an escaped literal.
+void patEscape(PatternCompiler &pc, ByteSet &b) {
+	if (pc.i >= pc.n) { pc.ok = false; return; }
+	char c = pc.p[pc.i++];
+	if (c == 'd') { for (int k = '0'; k <= '9'; ++k) byteSetAdd(b, k); }
+	else if (c == 'w') {
+		for (int k = 'a'; k <= 'z'; ++k) byteSetAdd(b, k);
+		for (int k = '0'; k <= '9'; ++k) byteSetAdd(b, k);
+		byteSetAdd(b, '_');
+	}
+	else if (c == 's') { for (int k = 0; k < 256; ++k) if (isspace(k)) byteSetAdd(b, k); }
+	else byteSetAdd(b, tolower((unsigned char)c));
+}
+
+void patClass(PatternCompiler &pc, ByteSet &b) {
+	bool negate = pc.i < pc.n && pc.p[pc.i] == '^';
+	if (negate) ++pc.i;
+	bool firstItem = true;
+	while (pc.i < pc.n && (pc.p[pc.i] != ']' || firstItem)) {
+		firstItem = false;
+		if (pc.p[pc.i] == '\\') { ++pc.i; patEscape(pc, b); continue; }
+		int lo = (unsigned char)pc.p[pc.i++];
+		int hi = lo;
+		if (pc.i + 1 < pc.n && pc.p[pc.i] == '-' && pc.p[pc.i + 1] != ']') { hi = (unsigned char)pc.p[pc.i + 1]; pc.i += 2; }
+		if (hi < lo) { pc.ok = false; return; }
+		for (int k = lo; k <= hi; ++k) byteSetAdd(b, tolower(k));
+	}
+	if (pc.i >= pc.n) { pc.ok = false; return; }
+	++pc.i; // ']'
+	if (negate) for (int k = 0; k < 4; ++k) b.w[k] = ~b.w[k];
+}
+
+PatFrag patAlt(PatternCompiler &pc);
+
+PatFrag patAtom(PatternCompiler &pc) {
+	ByteSet b = { { 0, 0, 0, 0 } };
+	char c = pc.p[pc.i++];
+	if (c == '(') {
+		PatFrag f = patAlt(pc);
+		if (pc.i >= pc.n || pc.p[pc.i] != ')') { pc.ok = false; return f; }
+		++pc.i;
+		return f;
+	}
+	if (c == '[') patClass(pc, b);
+	else if (c == '.') { for (int k = 0; k < 4; ++k) b.w[k] = ~0ull; }
+	else if (c == '\\') patEscape(pc, b);
+	else if (c == ')' || c == '*' || c == '+' || c == '?') pc.ok = false;
+	else byteSetAdd(b, tolower((unsigned char)c));
+	return patConsume(pc, b);
+}
+
+PatFrag patRepeat(PatternCompiler &pc) {
+	PatFrag f = patAtom(pc);
+	while (pc.ok && pc.i < pc.n && (pc.p[pc.i] == '*' || pc.p[pc.i] == '+' || pc.p[pc.i] == '?')) {
+		char op = pc.p[pc.i++];
+		int e = patNode(pc, -1, -1, -1);
+		if (op == '*') {
+			pc.nodes[f.end].out1 = f.start;
+			pc.nodes[f.end].out2 = e;
+			f.start = patNode(pc, -1, f.start, e);
+		}
+		else if (op == '+') {
+			pc.nodes[f.end].out1 = f.start;
+			pc.nodes[f.end].out2 = e;
+		}
+		else {
+			pc.nodes[f.end].out1 = e;
+			f.start = patNode(pc, -1, f.start, e);
+		}
+		f.end = e;
+	}
+	return f;
+}
+
+PatFrag patConcat(PatternCompiler &pc) {
+	int e = patNode(pc, -1, -1, -1);
+	PatFrag f = { e, e };
+	while (pc.ok && pc.i < pc.n && pc.p[pc.i] != '|' && pc.p[pc.i] != ')') {
+		PatFrag g = patRepeat(pc);
+		pc.nodes[f.end].out1 = g.start;
+		f.end = g.end;
+	}
+	return f;
+}
+
+PatFrag patAlt(PatternCompiler &pc) {
+	PatFrag f = patConcat(pc);
+	while (pc.ok && pc.i < pc.n && pc.p[pc.i] == '|') {
+		++pc.i;
+		PatFrag g = patConcat(pc);
+		int e = patNode(pc, -1, -1, -1);
+		pc.nodes[f.end].out1 = e;
+		pc.nodes[g.end].out1 = e;
+		f.start = patNode(pc, -1, f.start, g.start);
+		f.end = e;
+	}
+	return f;
+}
+
+// Expands 'states' (sorted on return) with everything reachable by epsilon moves.
+void patClosure(const PatternCompiler &pc, vector<int> &states, vector<char> &mark) {
+	vector<int> stack(states);
+	for (size_t k = 0; k < states.size(); ++k) mark[states[k]] = 1;
+	while (!stack.empty()) {
+		int s = stack.back();
+		stack.pop_back();
+		const NfaNode &nd = pc.nodes[s];
+		if (nd.set >= 0) continue;
+		int outs[2] = { nd.out1, nd.out2 };
+		for (int k = 0; k < 2; ++k) {
+			if (outs[k] < 0 || mark[outs[k]]) continue;
+			mark[outs[k]] = 1;
+			states.push_back(outs[k]);
+			stack.push_back(outs[k]);
+		}
+	}
+	for (size_t k = 0; k < states.size(); ++k) mark[states[k]] = 0;
+	sort(states.begin(), states.end());
+}
+
+bool compilePattern(const char* pattern, AnswerDfa &dfa) {
+	PatternCompiler pc;
+	pc.p = pattern;
+	pc.n = strlen(pattern);
+	pc.i = 0;
+	pc.ok = true;
+	PatFrag f = patAlt(pc);
+	if (!pc.ok || pc.i != pc.n) return false;
+	int acceptNode = f.end;
+
+	// bytes no set tells apart share a class
+	unordered_map<string, int> signatures;
+	int rep[256];
+	for (int b = 0; b < 256; ++b) {
+		string sig(pc.sets.size(), '0');
+		for (size_t k = 0; k < pc.sets.size(); ++k) if (byteSetHas(pc.sets[k], b)) sig[k] = '1';
+		unordered_map<string, int>::iterator it = signatures.find(sig);
+		if (it == signatures.end()) {
+			it = signatures.insert(make_pair(sig, (int)signatures.size())).first;
+			rep[it->second] = b;
+		}
+		dfa.classOf[b] = (unsigned char)it->second;
+	}
+	dfa.classes = (int)signatures.size();
+
+	vector<char> mark(pc.nodes.size(), 0);
+	unordered_map<string, int> ids;
+	vector<vector<int> > states;
+	vector<int> cur(1, f.start);
+	patClosure(pc, cur, mark);
+	ids[string((const char*)cur.data(), cur.size() * sizeof(int))] = 0;
+	states.push_back(cur);
+	dfa.start = 0;
+	for (size_t s = 0; s < states.size(); ++s) {
+		dfa.accept.push_back(binary_search(states[s].begin(), states[s].end(), acceptNode) ? 1 : 0);
+		for (int c = 0; c < dfa.classes; ++c) {
+			vector<int> next;
+			for (size_t k = 0; k < states[s].size(); ++k) {
+				const NfaNode &nd = pc.nodes[states[s][k]];
+				if (nd.set >= 0 && byteSetHas(pc.sets[nd.set], rep[c]) && !mark[nd.out1]) { mark[nd.out1] = 1; next.push_back(nd.out1); }
+			}
+			for (size_t k = 0; k < next.size(); ++k) mark[next[k]] = 0;
+			if (next.empty()) { dfa.next.push_back(-1); continue; }
+			patClosure(pc, next, mark);
+			string key((const char*)next.data(), next.size() * sizeof(int));
+			unordered_map<string, int>::iterator it = ids.find(key);
+			if (it == ids.end()) {
+				if ((int)states.size() >= PATTERN_MAX_STATES) return false;
+				it = ids.insert(make_pair(key, (int)states.size())).first;
+				states.push_back(next);
+			}
+			dfa.next.push_back(it->second);
+		}
+	}
+	return true;
+}
+
+// Shortest input the DFA accepts, built from printable lowercase bytes.
+bool patternSample(const AnswerDfa &d, string &out) {
+	int rep[256];
+	for (int c = 0; c < d.classes; ++c) rep[c] = -1;
+	for (int b = 0x20; b < 0x7F; ++b) {
+		if (isupper(b)) continue;
+		int c = d.classOf[b];
+		if (rep[c] < 0 || (isalnum(b) && !isalnum(rep[c]))) rep[c] = b;
+	}
+	int count = (int)d.accept.size();
+	vector<int> from(count, -2), via(count, -1);
+	deque<int> queue;
+	from[d.start] = -1;
+	queue.push_back(d.start);
+	while (!queue.empty()) {
+		int s = queue.front();
+		queue.pop_front();
+		if (d.accept[s]) {
+			for (; from[s] >= 0; s = from[s]) out.push_back((char)via[s]);
+			reverse(out.begin(), out.end());
+			return true;
+		}
+		for (int c = 0; c < d.classes; ++c) {
+			int t = d.next[(size_t)s * d.classes + c];
+			if (t < 0 || rep[c] < 0 || from[t] != -2) continue;
+			from[t] = s;
+			via[t] = rep[c];
+			queue.push_back(t);
+		}
+	}
+	return false;
+}
+
+void releaseAnswerMatchers() {
+	vector<AnswerMatcher>().swap(*answerMatchers);
+	vector<AnswerRange>().swap(*answerRanges);
+	vector<AnswerDfa>().swap(*answerDfas);
+	vector<AnswerEntry>().swap(*answerTable);
+	vector<AnswerText>().swap(*answerTexts);
+}
+
+// Calls fn(span) for every non-empty '|'-separated alternative of 'answer'.
+template<typename Fn>
+void forEachAlternative(const char* answer, Fn fn) {
+	const char* p = answer;
+	while (true) {
+		const char* bar = strchr(p, '|');
+		size_t len = bar ? (size_t)(bar - p) : strlen(p);
+		size_t st, ed;
+		answerTrim(p, len, st, ed);
+		if (ed > st) fn(p + st, ed - st);
+		if (!bar) break;
+		p = bar + 1;
+	}
+}
+
+void compileTextAnswers(int i, AnswerMatcher &m) {
+	m.type = PT_TEXT;
+	m.first = (int)answerTexts.size();
+	const char* first = nullptr;
+	size_t firstLen = 0;
+	forEachAlternative(objectPuzzleAnswer[i], [&](const char* s, size_t n) {
+		const char* text = addTextAnswer(i, s, n);
+		if (text) { AnswerText a = { text, (int)n }; answerTexts->push_back(a); }
+		if (!first) { first = s; firstLen = n; }
+	});
+	if (!first) { addTextAnswer(i, "", 0); first = ""; }
+	m.count = (int)answerTexts.size() - m.first;
+	char* sample = arenaCopy(catalogArena, first, firstLen);
+	for (size_t k = 0; k < firstLen; ++k) sample[k] = (char)tolower((unsigned char)sample[k]);
+	m.sample = sample;
+}
+
+// Upper bound on the text answers an object adds to answerTable.
+size_t countAnswerAlternatives(int i) {
+	size_t c = 1;
+	for (const char* p = objectPuzzleAnswer[i]; *p; ++p) if (*p == '|') ++c;
+	return c;
+}
+
+// Sizes the matcher tables for the whole catalog before any object is compiled.
+void prepareAnswerMatchers(size_t textAnswers) {
+	releaseAnswerMatchers();
+	answerMatchers->resize((size_t)totalObjects);
+	size_t tableSize = 16;
+	while (tableSize < textAnswers * 2) tableSize *= 2;
+	AnswerEntry empty = { 0, -1, nullptr, 0 };
+	answerTable->assign(tableSize, empty);
+}
+
+// Builds one object's matcher; warns about an answer it cannot compile.
+void compileAnswerMatcher(int i) {
+	AnswerMatcher &m = answerMatchers[i];
+	m.type = objectHasPuzzle[i] ? objectPuzzleType[i] : PT_NONE;
+	m.first = (int)answerRanges.size();
+	m.count = 0;
+	m.choices = 0;
+	m.dfa = -1;
+	m.sample = "";
+	const char* answer = objectPuzzleAnswer[i];
+	char buf[48];
+	if (m.type == PT_NONE) return;
+	if (m.type == PT_NUMBER || m.type == PT_RANGE) {
+		bool ranges = m.type == PT_RANGE;
+		forEachAlternative(answer, [&](const char* s, size_t n) {
+			AnswerRange r;
+			size_t cut = n;
+			if (ranges) for (size_t k = 0; k + 1 < n; ++k) if (s[k] == '.' && s[k + 1] == '.') { cut = k; break; }
+			if (cut < n) {
+				if (!parseAnswerNumber(s, cut, r.lo) || !parseAnswerNumber(s + cut + 2, n - cut - 2, r.hi) || r.hi < r.lo) return;
+			}
+			else {
+				if (!parseAnswerNumber(s, n, r.lo)) return;
+				r.hi = r.lo;
+			}
+			answerRanges->push_back(r);
+		});
+		m.count = (int)answerRanges.size() - m.first;
+		if (m.count == 0) { cout << "Object '" << objectNames[i] << "': no valid number in answer '" << answer << "'.\n"; return; }
+		sprintf_s(buf, sizeof(buf), "%lld", answerRanges[m.first].lo);
+		m.sample = arenaCopy(catalogArena, buf, strlen(buf));
+	}
+	else if (m.type == PT_CHOICE) {
+		forEachAlternative(answer, [&](const char* s, size_t n) {
+			int label = choiceLabel(s, n);
+			if (label >= 0) m.choices |= 1ull << label;
+		});
+		if (m.choices == 0) { cout << "Object '" << objectNames[i] << "': no valid option label in answer '" << answer << "'.\n"; return; }
+		int label = 0;
+		while (!((m.choices >> label) & 1)) ++label;
+		buf[0] = label < 26 ? (char)('a' + label) : (char)('0' + label - 26);
+		m.sample = arenaCopy(catalogArena, buf, 1);
+	}
+	else if (m.type == PT_PATTERN) {
+		AnswerDfa dfa;
+		string sample;
+		if (!compilePattern(answer, dfa) || !patternSample(dfa, sample)) {
+			cout << "Object '" << objectNames[i] << "': cannot compile answer pattern '" << answer << "'; matching it as text.\n";
+			compileTextAnswers(i, m);
+			return;
+		}
+		m.dfa = (int)answerDfas.size();
+		answerDfas->push_back(dfa);
+		m.sample = arenaCopy(catalogArena, sample.data(), sample.size());
+	}
+	else compileTextAnswers(i, m);
+}
+
+void compileAnswerMatchers() {
+	size_t textAnswers = 0;
+	for (int i = 0; i < totalObjects; ++i) textAnswers += countAnswerAlternatives(i);
+	prepareAnswerMatchers(textAnswers);
+	for (int i = 0; i < totalObjects; ++i) compileAnswerMatcher(i);
+}
+
+const char* answerSample(int puzzle) { return answerMatchers[puzzle].sample; }
+
+/* ========== Item dictionary ========== */
+
+// Same hash as the text answers, with a puzzle no object has.
+uint64_t itemHash(const char* s, size_t n) { return answerHash(-1, s, n); }
+
+// Id of an item name (case and surrounding spaces ignored), -1 if no object gives it.
+int findItemId(const char* s, size_t n) {
+	size_t st, ed;
+	answerTrim(s, n, st, ed);
+	if (!itemTable || ed == st) return -1;
+	for (size_t i = (size_t)itemHash(s + st, ed - st) & itemTableMask; itemTable[i] >= 0; i = (i + 1) & itemTableMask) {
+		if (spanIEquals(s + st, ed - st, itemNames[itemTable[i]])) return itemTable[i];
+	}
+	return -1;
+}
+
+void releaseItemDictionary() {
+	if (itemNames) { delete[] itemNames; itemNames = nullptr; }
+	if (objectItemId) { delete[] objectItemId; objectItemId = nullptr; }
+	if (itemTable) { delete[] itemTable; itemTable = nullptr; }
+	itemTableMask = 0;
+	totalItems = 0;
+}
+
+// Room for up to 'maxItems' names; every object starts without an item.
+bool prepareItemDictionary(int maxItems) {
+	releaseItemDictionary();
+	size_t tableSize = 16;
+	while (tableSize < (size_t)maxItems * 2) tableSize *= 2;
+	itemNames = new(nothrow) const char*[maxItems > 0 ? maxItems : 1];
+	objectItemId = new(nothrow) int[totalObjects > 0 ? totalObjects : 1];
+	itemTable = new(nothrow) int[tableSize];
+	if (!itemNames || !objectItemId || !itemTable) { cerr << "Memory alloc failed\n"; releaseItemDictionary(); return false; }
+	itemTableMask = tableSize - 1;
+	for (size_t i = 0; i < tableSize; ++i) itemTable[i] = -1;
+	for (int i = 0; i < totalObjects; ++i) objectItemId[i] = -1;
+	return true;
+}
+
+// Id of a (non-empty, trimmed) name, giving it the next id if it is new.
+int internItem(const char* name, size_t n) {
+	size_t slot = (size_t)itemHash(name, n) & itemTableMask;
+	while (itemTable[slot] >= 0 && !spanIEquals(name, n, itemNames[itemTable[slot]])) slot = (slot + 1) & itemTableMask;
+	if (itemTable[slot] < 0) {
+		itemNames[totalItems] = name;
+		itemTable[slot] = totalItems++;
+	}
+	return itemTable[slot];
+}
+
+// Interns every object's item name; ids follow the catalog order.
+bool buildItemDictionary() {
+	if (!prepareItemDictionary(totalObjects)) return false;
+	for (int i = 0; i < totalObjects; ++i) {
+		const char* name = objectItemName[i];
+		size_t n = strlen(name);
+		if (objectGivesItem[i] && n > 0) objectItemId[i] = internItem(name, n);
+	}
+	return true;
+}
+
+// FNV-1a over the item names in id order (case-folded, as they are matched).
+// Saves carry it so item ids are only read back against the same dictionary.
+uint64_t itemDictionaryHash() {
+	uint64_t h = 14695981039346656037ull;
+	for (int i = 0; i < totalItems; ++i) {
+		for (const char* p = itemNames[i]; ; ++p) {
+			h ^= (unsigned char)tolower((unsigned char)*p);
+			h *= 1099511628211ull;
+			if (!*p) break;
+		}
+	}
+	return h;
+}
+
+/* ========== Item interactions ========== */
+
+// (item id, catalog object) -> UseEffect mask, open-addressed. Built from the
+// interaction rules once the item dictionary exists, so using an item is one
+// probe with no string work.
+struct InteractionEntry {
+	int item;   // -1 = empty slot
+	int object;
+	int effect;
+};
+
+thread_local CatalogVector<InteractionEntry> interactionTable;
+
+size_t interactionSlot(int itemId, int object) {
+	uint64_t h = ((uint64_t)(uint32_t)itemId << 32 | (uint32_t)object) * 0x9E3779B97F4A7C15ull;
+	return (size_t)(h >> 32) & (interactionTable.size() - 1);
+}
+
+void releaseInteractionTable() {
+	vector<InteractionEntry>().swap(*interactionTable);
+}
+
+void prepareInteractionTable(int rules) {
+	size_t tableSize = 16;
+	while (tableSize < (size_t)rules * 2) tableSize *= 2;
+	InteractionEntry empty = { -1, -1, 0 };
+	interactionTable->assign(tableSize, empty);
+}
+
+void addInteractionRule(int i) {
+	const char* name = interactionItemName[i];
+	int itemId = findItemId(name, strlen(name));
+	if (itemId < 0) { cout << "Object '" << objectNames[interactionObject[i]] << "': no object gives the item '" << name << "'.\n"; return; }
+	size_t mask = interactionTable.size() - 1;
+	size_t slot = interactionSlot(itemId, interactionObject[i]);
+	while (interactionTable[slot].item >= 0 && (interactionTable[slot].item != itemId || interactionTable[slot].object != interactionObject[i])) slot = (slot + 1) & mask;
+	// a repeated rule overrides the earlier one
+	interactionTable[slot].item = itemId;
+	interactionTable[slot].object = interactionObject[i];
+	interactionTable[slot].effect = interactionEffect[i];
+}
+
+void compileInteractionTable() {
+	prepareInteractionTable(totalInteractions);
+	for (int i = 0; i < totalInteractions; ++i) addInteractionRule(i);
+}
+
+// Effect of using an item on an object (0 = nothing happens).
+int findInteraction(int itemId, int object) {
+	if (interactionTable.empty()) return 0;
+	size_t mask = interactionTable.size() - 1;
+	for (size_t slot = interactionSlot(itemId, object); interactionTable[slot].item >= 0; slot = (slot + 1) & mask) {
+		const InteractionEntry &e = interactionTable[slot];
+		if (e.item == itemId && e.object == object) return e.effect;
+	}
+	return 0;
+}
+
+void buildRoomLayouts();
+void buildRoomLayout(int r);
+void prepareRoomLayouts();
+void publishCatalog(const shared_ptr<Catalog> &c);
+void putBytes(vector<char> &out, const void* p, size_t n);
+
+/* ========== Lazy room loading ========== */
+
+// rooms.idx lets the console start without parsing rooms.txt, or reading
+// anything in proportion to it: the index is mapped, and the room object
+// ranges and puzzle flags the session tables and the puzzle shuffle need for
+// every room are used in place. Layout (little-endian, 4-byte ints):
+//   RoomIndexHeader
+//   RoomBlock[roomCount]
+//   int32_t roomObjectStart[roomCount]
+//   int32_t roomObjectCount[roomCount]
+//   int32_t objectHasPuzzle[objectCount]
+//   item names, NUL-terminated, in id order
+// The work that does cover the whole catalog (checking the object ranges, the
+// item dictionary, sizing the lookup tables) waits for the first session
+// (prepareIndexedCatalog). A room is read from rooms.txt and parsed the first
+// time it is entered, while a background thread reads ahead the room after
+// it. rooms.txt is not kept mapped: authors edit it in place, and each read
+// first checks that it is still the file the index describes.
+const char INDEX_MAGIC[4] = { 'E', 'R', 'I', 'X' };
+const uint32_t INDEX_VERSION = 2;
+
+struct RoomIndexHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t roomCount;
+	uint32_t objectCount;
+	uint32_t itemCount;
+	uint32_t textAnswerCount;   // sizes answerTable before any room is parsed
+	uint32_t interactionCount;  // sizes the interaction table
+	uint32_t reserved;
+	int64_t sourceSize;         // rooms.txt the index describes
+	int64_t sourceMtime;        // in nanoseconds (statFile)
+};
+
+string indexSource;           // the rooms.txt the index describes
+vector<char> roomText;        // the block of the room being parsed
+MappedFile roomIndexFile;     // copy-on-write: parsing a room rewrites its entries with the same values
+bool roomIndexMapped = false;
+RoomIndexHeader roomIndexHeader;
+const RoomBlock* indexBlocks = nullptr;
+const char* indexItems = nullptr;
+bool indexPending = false;    // prepareIndexedCatalog has not run yet
+char* indexEmptyText = nullptr;
+vector<char> roomLoaded;      // per room; empty when the whole catalog was parsed up front
+int lazyInteractionCap = 0;
+
+mutex prefetchMutex;
+condition_variable prefetchCv;
+thread prefetchThread;
+int prefetchRequest = -1;
+RoomBlock prefetchBlock;     // a copy: indexBlocks are not checked yet
+bool prefetchStop = false;
+atomic<unsigned> prefetchSink{ 0 };
+
+void roomPrefetchMain() {
+	unique_lock<mutex> lk(prefetchMutex);
+	while (true) {
+		while (prefetchRequest < 0 && !prefetchStop) prefetchCv.wait(lk);
+		if (prefetchStop) break;
+		RoomBlock b = prefetchBlock;
+		prefetchRequest = -1;
+		lk.unlock();
+		// read and dropped, so entering the room finds it in the OS cache
+		ifstream fin(indexSource.c_str(), ios::binary);
+		fin.seekg((streamoff)b.offset);
+		vector<char> buf(b.length);
+		if (fin && b.length > 0) fin.read(buf.data(), (streamsize)b.length);
+		prefetchSink.fetch_add(buf.empty() ? 0u : (unsigned char)buf[0], memory_order_relaxed);
+		lk.lock();
+	}
+}
+
+// Asks the prefetch thread to page in room r (no-op once it is parsed).
+void prefetchRoom(int r) {
+	if (r < 0 || r >= (int)roomLoaded.size() || roomLoaded[r]) return;
+	const RoomBlock &b = indexBlocks[r];
+	if (b.offset > (uint64_t)roomIndexHeader.sourceSize || b.length > (uint64_t)roomIndexHeader.sourceSize - b.offset) return; // ensureRoomLoaded reports it
+	{
+		lock_guard<mutex> lk(prefetchMutex);
+		if (!prefetchThread.joinable()) {
+			prefetchStop = false;
+			prefetchThread = thread(roomPrefetchMain);
+		}
+		prefetchRequest = r;
+		prefetchBlock = b;
+	}
+	prefetchCv.notify_one();
+}
+
+void stopRoomPrefetch() {
+	if (!prefetchThread.joinable()) return;
+	{
+		lock_guard<mutex> lk(prefetchMutex);
+		prefetchStop = true;
+	}
+	prefetchCv.notify_all();
+	prefetchThread.join();
+	prefetchRequest = -1;
+}
+
+// Forgets the catalog tables that point into the mapped rooms.idx; they are
+// not the catalog's to delete.
+void dropIndexedTables() {
+	if (!roomIndexMapped) return;
+	roomObjectStart = nullptr;
+	roomObjectCount = nullptr;
+	objectHasPuzzle = nullptr;
+}
+
+void releaseLazyRooms() {
+	stopRoomPrefetch();
+	dropIndexedTables();
+	if (roomIndexMapped) unmapFile(roomIndexFile);
+	roomIndexMapped = false;
+	indexBlocks = nullptr;
+	indexItems = nullptr;
+	indexPending = false;
+	vector<char>().swap(roomText);
+	vector<char>().swap(roomLoaded);
+	vector<RoomBlock>().swap(roomBlocks);
+	lazyInteractionCap = 0;
+}
+
+// True while rooms.txt is still the file the index was built from.
+bool indexSourceCurrent() {
+	int64_t size = 0, mtime = 0;
+	return statFile(indexSource.c_str(), size, mtime) && size == roomIndexHeader.sourceSize && mtime == roomIndexHeader.sourceMtime;
+}
+
+// Checks what the sessions need for every room and object; false if the
+// index does not hold together.
+bool indexedTablesHold() {
+	int64_t next = 0;
+	for (int r = 0; r < totalRooms; ++r) {
+		if (roomObjectStart[r] != next || roomObjectCount[r] < 0) return false;
+		next += roomObjectCount[r];
+	}
+	return next == totalObjects;
+}
+
+// Interns the item names stored after the index tables, in the order the
+// full parse numbered them.
+bool internIndexedItems() {
+	if (!prepareItemDictionary((int)roomIndexHeader.itemCount)) return false;
+	const char* p = indexItems;
+	const char* end = roomIndexFile.data + roomIndexFile.size;
+	for (uint32_t i = 0; i < roomIndexHeader.itemCount; ++i) {
+		const char* nul = (const char*)memchr(p, '\0', (size_t)(end - p));
+		if (!nul || nul == p) return false;
+		internItem(arenaCopy(catalogArena, p, (size_t)(nul - p)), (size_t)(nul - p));
+		p = nul + 1;
+	}
+	return totalItems == (int)roomIndexHeader.itemCount;
+}
+
+bool loadRoomsFromFile(const char* fname);
+bool compileCatalog();
+void writeRoomIndex(const char* txtName, const char* idxName);
+void stopSaveWriter();
+void stopLeaderboardCompactor();
+
+// Does what an indexed start skipped, before the first session uses the
+// catalog: checks that the room object ranges tile the objects, builds the
+// item dictionary and sizes the lookup tables. If rooms.txt changed since
+// start-up or the index is damaged, the whole file is parsed instead (no
+// session uses the catalog yet) and a new index written. No-op for any
+// other catalog.
+void prepareIndexedCatalog() {
+	if (!indexPending) return;
+	indexPending = false;
+	if (indexSourceCurrent() && indexedTablesHold() && internIndexedItems()) {
+		indexEmptyText = arenaCopy(catalogArena, "", 0);
+		prepareAnswerMatchers(roomIndexHeader.textAnswerCount);
+		prepareInteractionTable((int)roomIndexHeader.interactionCount);
+		prepareRoomLayouts();
+		roomLoaded.assign((size_t)totalRooms, 0);
+		captureCatalog(*boundCatalog);
+		return;
+	}
+	string txt = indexSource;
+	cout << "Room index '" << ROOMS_INDEX << "' no longer matches '" << txt << "'; reading the whole file.\n";
+	freeAllMemory();
+	remove(ROOMS_INDEX);
+	bool ok = loadRoomsFromFile(txt.c_str()) && compileCatalog();
+	captureCatalog(*boundCatalog);
+	if (ok) { writeRoomIndex(txt.c_str(), ROOMS_INDEX); return; }
+	cout << "Failed to load rooms. Make sure '" << txt << "' exists and is formatted correctly.\n";
+	// exit() does not join the background threads
+	stopSaveWriter();
+	stopLeaderboardCompactor();
+	exit(1);
+}
+
+// Reads room r's block of rooms.txt into roomText. False, with a message, if
+// the file is no longer the one the index describes or the index points past
+// its end (the index is then removed, so the next start parses rooms.txt).
+bool readRoomBlock(int r) {
+	const RoomBlock &b = indexBlocks[r];
+	if (b.objectStart != roomObjectStart[r] || b.objectCount != roomObjectCount[r]
+		|| b.offset > (uint64_t)roomIndexHeader.sourceSize || b.length > (uint64_t)roomIndexHeader.sourceSize - b.offset) {
+		cout << "Room index '" << ROOMS_INDEX << "' is damaged and has been removed.\n";
+		remove(ROOMS_INDEX);
+		return false;
+	}
+	bool ok = indexSourceCurrent();
+	if (ok) {
+		roomText.resize(b.length);
+		ifstream fin(indexSource.c_str(), ios::binary);
+		fin.seekg((streamoff)b.offset);
+		if (b.length > 0) fin.read(roomText.data(), (streamsize)b.length);
+		// a write that landed during the read shows up in the mtime
+		ok = fin && indexSourceCurrent();
+	}
+	if (!ok) cout << "'" << indexSource << "' has changed since the game started.\n";
+	return ok;
+}
+
+// Parses room r out of rooms.txt the first time it is needed and compiles
+// what the loaded catalog compiles for every room at start-up. Returns false,
+// leaving the room unread, if its text can no longer be trusted.
+bool ensureRoomLoaded(int r) {
+	if (r < 0 || r >= (int)roomLoaded.size() || roomLoaded[r]) return true;
+	if (!readRoomBlock(r)) return false;
+	const RoomBlock &b = indexBlocks[r];
+	// what a block with fewer objects than indexed leaves unset
+	roomNames[r] = roomDescriptions[r] = indexEmptyText;
+	for (int i = b.objectStart; i < b.objectStart + b.objectCount; ++i) {
+		objectNames[i] = objectDescriptions[i] = objectPuzzlePrompt[i] = objectPuzzleAnswer[i] = objectItemName[i] = indexEmptyText;
+		objectPuzzleType[i] = 0;
+		objectGivesItem[i] = 0;
+	}
+	TextCursor cur;
+	cur.p = roomText.data();
+	cur.end = cur.p + roomText.size();
+	const char* s = nullptr;
+	size_t n = 0;
+	int firstRule = totalInteractions;
+	if (nextNonEmptyLine(cur, s, n) && spanIEquals(s, n, "ROOM")) {
+		parseRoomBody(catalogArena, cur, r, b.objectStart, b.objectCount, nullptr);
+		roomObjectCount[r] = b.objectCount;
+		while (nextNonEmptyLine(cur, s, n)) {
+			if (spanIStartsWith(s, n, "USE ")) parseInteractionLine(r, s, n, lazyInteractionCap);
+			else if (spanIEquals(s, n, "ROOM")) break;
+		}
+	}
+	for (int i = b.objectStart; i < b.objectStart + b.objectCount; ++i) {
+		size_t len = strlen(objectItemName[i]);
+		if (objectGivesItem[i] && len > 0) objectItemId[i] = findItemId(objectItemName[i], len);
+		compileAnswerMatcher(i);
+	}
+	for (int i = firstRule; i < totalInteractions; ++i) addInteractionRule(i);
+	buildRoomLayout(r);
+	roomLoaded[r] = 1;
+	captureCatalog(*boundCatalog);
+	return true;
+}
+
+bool writeFileViaTemp(const char* path, const vector<char> &data, bool sync);
+
+// Writes rooms.idx for the catalog just parsed from 'txtName'. Best effort:
+// without an index the next start simply parses everything again.
+void writeRoomIndex(const char* txtName, const char* idxName) {
+	RoomIndexHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, INDEX_MAGIC, 4);
+	h.version = INDEX_VERSION;
+	h.roomCount = (uint32_t)totalRooms;
+	h.objectCount = (uint32_t)totalObjects;
+	h.itemCount = (uint32_t)totalItems;
+	size_t textAnswers = 0;
+	for (int i = 0; i < totalObjects; ++i) textAnswers += countAnswerAlternatives(i);
+	h.textAnswerCount = (uint32_t)textAnswers;
+	h.interactionCount = (uint32_t)totalInteractions;
+	if (!statFile(txtName, h.sourceSize, h.sourceMtime)) return;
+	vector<char> out;
+	putBytes(out, &h, sizeof(h));
+	if (totalRooms > 0) {
+		putBytes(out, roomBlocks.data(), roomBlocks.size() * sizeof(RoomBlock));
+		putBytes(out, roomObjectStart, (size_t)totalRooms * sizeof(int32_t));
+		putBytes(out, roomObjectCount, (size_t)totalRooms * sizeof(int32_t));
+	}
+	if (totalObjects > 0) putBytes(out, objectHasPuzzle, (size_t)totalObjects * sizeof(int32_t));
+	for (int i = 0; i < totalItems; ++i) putBytes(out, itemNames[i], strlen(itemNames[i]) + 1);
+	// renamed into place: another console may have the old index mapped
+	writeFileViaTemp(idxName, out, false);
+}
+
+// Sets the catalog up from rooms.idx without parsing any room. Returns false
+// (leaving the catalog empty) if the index is missing, stale or the wrong
+// size; its contents are checked as they are first used.
+bool loadRoomIndex(const char* txtName, const char* idxName) {
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	int64_t srcSize = 0, srcMtime = 0;
+	if (!statFile(txtName, srcSize, srcMtime)) return false;
+	if (!mapFile(idxName, roomIndexFile, true)) return false;
+	roomIndexMapped = true;
+	RoomIndexHeader h;
+	if (roomIndexFile.size < sizeof(h)) { freeAllMemory(); return false; }
+	memcpy(&h, roomIndexFile.data, sizeof(h));
+	uint64_t fixedBytes = sizeof(h) + (uint64_t)h.roomCount * (sizeof(RoomBlock) + 2 * sizeof(int32_t)) + (uint64_t)h.objectCount * sizeof(int32_t);
+	if (memcmp(h.magic, INDEX_MAGIC, 4) != 0 || h.version != INDEX_VERSION || h.sourceSize != srcSize || h.sourceMtime != srcMtime
+		|| h.roomCount == 0 || h.roomCount > (uint32_t)INT_MAX || h.objectCount > (uint32_t)INT_MAX || h.itemCount > h.objectCount
+		|| h.interactionCount > (uint32_t)INT_MAX || fixedBytes > (uint64_t)roomIndexFile.size) { freeAllMemory(); return false; }
+	indexSource = txtName;
+
+	int nRooms = (int)h.roomCount;
+	int nObjects = (int)h.objectCount;
+	char* base = (char*)roomIndexFile.data;
+	indexBlocks = (const RoomBlock*)(base + sizeof(h));
+	roomObjectStart = (int*)(base + sizeof(h) + (size_t)nRooms * sizeof(RoomBlock));
+	roomObjectCount = roomObjectStart + nRooms;
+	objectHasPuzzle = roomObjectCount + nRooms;
+	indexItems = (const char*)(objectHasPuzzle + nObjects);
+
+	// the rest is filled in room by room as the rooms are parsed
+	int objSlots = nObjects > 0 ? nObjects : 1;
+	roomNames = new(nothrow) char*[nRooms];
+	roomDescriptions = new(nothrow) char*[nRooms];
+	objectNames = new(nothrow) char*[objSlots];
+	objectDescriptions = new(nothrow) char*[objSlots];
+	objectPuzzleType = new(nothrow) int[objSlots];
+	objectPuzzlePrompt = new(nothrow) char*[objSlots];
+	objectPuzzleAnswer = new(nothrow) char*[objSlots];
+	objectGivesItem = new(nothrow) int[objSlots];
+	objectItemName = new(nothrow) char*[objSlots];
+	if (!roomNames || !roomDescriptions || !objectNames || !objectDescriptions || !objectPuzzleType
+		|| !objectPuzzlePrompt || !objectPuzzleAnswer || !objectGivesItem || !objectItemName) {
+		cerr << "Memory alloc failed\n"; freeAllMemory(); return false;
+	}
+	totalRooms = nRooms;
+	totalObjects = nObjects;
+	roomIndexHeader = h;
+	indexPending = true;
+
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+	char msbuf[32]; sprintf_s(msbuf, "%.2f", ms);
+	cout << "Indexed " << totalRooms << " rooms and " << totalObjects << " objects from '" << idxName << "' in " << msbuf << " ms; rooms are read as they are entered.\n";
+	return true;
+}
+
+// Builds the lookup tables of a catalog whose rooms and objects are loaded.
+bool compileCatalog() {
+	if (!buildItemDictionary()) return false;
+	compileInteractionTable();
+	compileAnswerMatchers();
+	buildRoomLayouts();
+	return true;
+}
+
+// Prefers the compiled rooms.bin and falls back to rooms.txt. With 'lazy'
+// (the console) rooms.txt is only indexed when rooms.idx is up to date, and
+// a full parse writes a fresh rooms.idx for the next start. The catalog is
+// published as the first version and stays bound on this thread.
+bool loadCatalog(bool lazy) {
+	beginCatalog();
+	bool ok = false;
+	if (fileExists(ROOMS_PACK)) {
+		cout << "Loading rooms from '" << ROOMS_PACK << "'...\n";
+		ok = loadRoomsFromPack(ROOMS_PACK, ROOMS_TXT);
+	}
+	bool indexed = false;
+	if (!ok && lazy) ok = indexed = loadRoomIndex(ROOMS_TXT, ROOMS_INDEX);
+	bool fromText = false;
+	if (!ok) {
+		cout << "Loading rooms from '" << ROOMS_TXT << "'...\n";
+		ok = fromText = loadRoomsFromFile(ROOMS_TXT);
+	}
+	if (ok && !indexed) ok = compileCatalog();
+	if (ok && fromText && lazy) writeRoomIndex(ROOMS_TXT, ROOMS_INDEX);
+	shared_ptr<Catalog> c = finishCatalog(ok);
+	if (c) publishCatalog(c);
+	return ok;
+}
+
+/* ========== Random numbers ========== */
+
+// xoshiro256** seeded through splitmix64. Each session and simulator worker
+// owns its generator, so nothing is shared between threads, and a seed gives
+// the same sequence on every platform.
+struct Rng {
+	uint64_t s[4];
+};
+
+uint64_t splitMix64(uint64_t x) {
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+void rngSeed(Rng &r, uint64_t seed) {
+	for (int i = 0; i < 4; ++i) r.s[i] = splitMix64(seed + (uint64_t)i * 0x9E3779B97F4A7C15ull);
+}
+
+inline uint64_t rotl64(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+uint64_t rngNext(Rng &r) {
+	uint64_t result = rotl64(r.s[1] * 5, 7) * 9;
+	uint64_t t = r.s[1] << 17;
+	r.s[2] ^= r.s[0];
+	r.s[3] ^= r.s[1];
+	r.s[1] ^= r.s[2];
+	r.s[0] ^= r.s[3];
+	r.s[2] ^= t;
+	r.s[3] = rotl64(r.s[3], 45);
+	return result;
+}
+
+// Uniform integer in [lo, hi] (multiply-shift on the top 32 bits, no division).
+int rngRange(Rng &r, int lo, int hi) {
+	if (hi <= lo) return lo;
+	uint64_t span = (uint64_t)((int64_t)hi - lo) + 1;
+	return lo + (int)(((rngNext(r) >> 32) * span) >> 32);
+}
+
+// New games draw their layout seed from here: --seed=N makes a run
+// reproducible, otherwise the base comes from the clock.
+uint64_t gameSeedBase = 0;
+atomic<uint64_t> gameSeedSequence(0);
+
+uint64_t newGameSeed() {
+	return splitMix64(gameSeedBase + gameSeedSequence.fetch_add(1));
+}
+
+/* ========== Puzzle layout ========== */
+
+// The catalog is read-only once loaded. A session shuffles puzzles through
+// its own table instead: object 'pos' presents the puzzle (prompt, answer,
+// type and reward) authored for catalog object puzzleSource[pos]. Only
+// objects with puzzles are permuted, and only within their room.
+
+void resetPuzzleLayout(GameSession &gs) {
+	for (int i = 0; i < totalObjects; ++i) gs.puzzleSource[i] = i;
+}
+
+// Shuffles the layout from 'seed'; the same seed always gives the same layout.
+void randomizePuzzles(GameSession &gs, uint64_t seed) {
+	Rng rng;
+	rngSeed(rng, seed);
+	gs.layoutSeed = seed;
+	resetPuzzleLayout(gs);
+	int* idx = new(nothrow) int[totalObjects > 0 ? totalObjects : 1];
+	if (!idx) { cerr << "Memory alloc failed\n"; exit(1); }
+	for (int r = 0; r < totalRooms; ++r) {
+		int start = roomObjectStart[r];
+		int cnt = roomObjectCount[r];
+		int k = 0;
+		for (int j = 0; j < cnt; ++j) if (objectHasPuzzle[start + j]) idx[k++] = start + j;
+		for (int i = k - 1; i > 0; --i) {
+			int j = rngRange(rng, 0, i);
+			int t = gs.puzzleSource[idx[i]]; gs.puzzleSource[idx[i]] = gs.puzzleSource[idx[j]]; gs.puzzleSource[idx[j]] = t;
+		}
+	}
+	delete[] idx;
+}
+
+const char* puzzlePrompt(GameSession &gs, int pos) { return objectPuzzlePrompt[gs.puzzleSource[pos]]; }
+int puzzleType(GameSession &gs, int pos) { return objectPuzzleType[gs.puzzleSource[pos]]; }
+int puzzleItemId(GameSession &gs, int pos) { return objectItemId[gs.puzzleSource[pos]]; }
+const char* puzzleItemName(GameSession &gs, int pos) { return objectItemName[gs.puzzleSource[pos]]; }
+
+bool puzzleGivesItem(GameSession &gs, int pos) {
+	return puzzleItemId(gs, pos) >= 0;
+}
+
+/* ========== Puzzle check ========== */
+
+// Checks an answer against the puzzle authored for catalog object 'puzzle';
+// text answers may be up to 'maxEdits' typos off (see typoAllowance).
+bool checkCatalogAnswer(int puzzle, const char* input, size_t n, int maxEdits) {
+	if (puzzle < 0 || puzzle >= totalObjects) return false;
+	if (!objectHasPuzzle[puzzle]) return true;
+	const AnswerMatcher &m = answerMatchers[puzzle];
+	if (m.type == PT_NUMBER || m.type == PT_RANGE) {
+		long long v = 0;
+		if (!parseAnswerNumber(input, n, v)) return false;
+		for (int k = m.first; k < m.first + m.count; ++k) {
+			if (v >= answerRanges[k].lo && v <= answerRanges[k].hi) return true;
+		}
+		return false;
+	}
+	if (m.type == PT_CHOICE) {
+		int label = choiceLabel(input, n);
+		return label >= 0 && ((m.choices >> label) & 1);
+	}
+	if (m.type == PT_PATTERN) return dfaMatches(answerDfas[m.dfa], input, n);
+	return textAnswerMatches(puzzle, input, n, maxEdits);
+}
+
+bool checkPuzzleAnswerByIndex(GameSession &gs, int objIndex, const char* input, size_t n) {
+	if (objIndex < 0 || objIndex >= totalObjects) return false;
+	return checkCatalogAnswer(gs.puzzleSource[objIndex], input, n, typoAllowance(gs.difficultyLevel));
+}
+
+void puzzleHintText(GameSession &gs, int pos, char* out, int outSize) {
+	const AnswerMatcher &m = answerMatchers[gs.puzzleSource[pos]];
+	const char* sample = m.sample;
+	if ((m.type == PT_NUMBER || m.type == PT_RANGE) && m.count > 0) {
+		const AnswerRange &r = answerRanges[m.first];
+		if (r.lo == r.hi) sprintf_s(out, outSize, "The number is between %lld and %lld.", r.lo / 2, r.lo + 5);
+		else sprintf_s(out, outSize, "The number is between %lld and %lld.", r.lo, r.hi);
+	}
+	else if (m.type == PT_CHOICE && sample[0]) sprintf_s(out, outSize, "It is option '%c'.", sample[0]);
+	else {
+		size_t len = strlen(sample);
+		if (len >= 2) sprintf_s(out, outSize, "Starts with '%c%c'.", sample[0], sample[1]);
+		else if (len == 1) sprintf_s(out, outSize, "Starts with '%c'.", sample[0]);
+		else sprintf_s(out, outSize, "Look around closely.");
+	}
+}
+
+bool isRoomCompleted(GameSession &gs, int roomIdx) {
+	return gs.roomUnsolvedCount[roomIdx] == 0;
+}
+
+int scoreFor(int elapsed, int hints, int moves, int difficulty) {
+	int score = 100;
+	score -= elapsed / 10;
+	score -= hints * 5;
+	score -= moves / 2;
+	if (difficulty == 3) score += 10;
+	if (difficulty == 1) score -= 5;
+	if (score < 0) score = 0;
+	if (score > 100) score = 100;
+	return score;
+}
+
+int computeScore(GameSession &gs) {
+	int elapsed = gs.accumulatedElapsed + (int)difftime(time(nullptr), gs.startTime);
+	return scoreFor(elapsed, gs.hintsUsed, gs.totalMoves, gs.difficultyLevel);
+}
+
+// forward declarations
+bool writeSaveFile(GameSession &gs);
+void saveProgress(GameSession &gs, ostream &out);
+bool loadProgress(GameSession &gs);
+void maybeAutosave(GameSession &gs);
+void reportSave(bool ok, ostream &out);
+void reportSaveFailure(ostream &out);
+
+/* ========== Headless game engine ========== */
+
+// The engine owns all rule logic and never touches cin/cout: a front end
+// turns player input into EngineCommands and renders the EngineResults.
+// Commands address objects by their 0-based number within the current room
+// and items by their 0-based inventory slot.
+enum EngineCommandType {
+	CMD_INSPECT,      // select an object (a move); picks up items from puzzle-free objects
+	CMD_ANSWER,       // answer the object's puzzle with 'text'
+	CMD_HINT,         // ask for a hint on the object's puzzle (penalty)
+	CMD_USE_ITEM,     // use inventory slot 'item' on the object (see the item interactions)
+	CMD_DISCARD_ITEM, // drop inventory slot 'item' (consuming an item after use)
+	CMD_SAVE          // write the save file
+};
+
+struct EngineCommand {
+	EngineCommandType type;
+	int object;
+	int item;
+	const char* text;
+};
+
+enum EngineStatus {
+	ENGINE_OK,
+	ENGINE_INVALID,        // object/item out of range or command not applicable
+	ENGINE_ALREADY_SOLVED,
+	ENGINE_NO_PUZZLE,      // inspected object has nothing to solve
+	ENGINE_PUZZLE,         // inspected object has an unsolved puzzle
+	ENGINE_WRONG_ANSWER,
+	ENGINE_NO_EFFECT,      // item had no effect on the object
+	ENGINE_IO_ERROR
+};
+
+// Result of one command and the state it changed.
+struct EngineResult {
+	EngineStatus status;
+	int objectIndex;    // global object index the command touched, -1 if none
+	bool solved;        // the object became solved
+	bool roomCompleted; // that was the room's last unsolved object (door unlocked)
+	bool gameCompleted; // ... and the room was the last one
+	int itemGained;     // object whose item went into the inventory, -1 if none
+	int itemRemoved;    // inventory slot that was removed, -1 if none
+	int movesDelta;
+	int hintsDelta;
+	int roomIndex;      // current room after the command
+	char hint[128];     // hint text for CMD_HINT
+};
+
+void engineResetResult(GameSession &gs, EngineResult &res) {
+	res.status = ENGINE_OK;
+	res.objectIndex = -1;
+	res.solved = false;
+	res.roomCompleted = false;
+	res.gameCompleted = false;
+	res.itemGained = -1;
+	res.itemRemoved = -1;
+	res.movesDelta = 0;
+	res.hintsDelta = 0;
+	res.roomIndex = gs.currentRoomIndex;
+	res.hint[0] = '\0';
+}
+
+void engineNewGame(GameSession &gs, int difficulty, uint64_t seed) {
+	gs.difficultyLevel = difficulty;
+	resetSolvedState(gs);
+	clearInventory(gs);
+	randomizePuzzles(gs, seed);
+	gs.currentRoomIndex = 0;
+	gs.totalMoves = 0;
+	gs.hintsUsed = 0;
+	gs.accumulatedElapsed = 0;
+	gs.startTime = time(nullptr);
+	journalStartOver(gs);
+	gs.autosaveMovesMark = 0;
+}
+
+// Marks an object solved and unlocks the door when it was the room's last one;
+// the engine then moves on to the next room (the last room stays current).
+void engineSolve(GameSession &gs, int pos, EngineResult &res) {
+	markObjectSolved(gs, gs.currentRoomIndex, pos);
+	res.solved = true;
+	if (isRoomCompleted(gs, gs.currentRoomIndex)) {
+		res.roomCompleted = true;
+		if (gs.currentRoomIndex < totalRooms - 1) ++gs.currentRoomIndex;
+		else res.gameCompleted = true;
+	}
+}
+
+void engineGiveItem(GameSession &gs, int pos, EngineResult &res) {
+	if (puzzleGivesItem(gs, pos)) {
+		addInventory(gs, puzzleItemId(gs, pos));
+		res.itemGained = pos;
+	}
+}
+
+bool engineApply(GameSession &gs, const EngineCommand &cmd, EngineResult &res) {
+	engineResetResult(gs, res);
+	int r = gs.currentRoomIndex;
+	bool needsObject = cmd.type == CMD_INSPECT || cmd.type == CMD_ANSWER || cmd.type == CMD_HINT || cmd.type == CMD_USE_ITEM;
+	bool needsItem = cmd.type == CMD_USE_ITEM || cmd.type == CMD_DISCARD_ITEM;
+	if (needsObject && (cmd.object < 0 || cmd.object >= roomObjectCount[r])) { res.status = ENGINE_INVALID; return false; }
+	if (needsItem && (cmd.item < 0 || cmd.item >= gs.invCount)) { res.status = ENGINE_INVALID; return false; }
+	int pos = needsObject ? roomObjectStart[r] + cmd.object : -1;
+	res.objectIndex = pos;
+
+	switch (cmd.type) {
+	case CMD_INSPECT:
+		++gs.totalMoves;
+		res.movesDelta = 1;
+		if (isObjectSolved(gs, pos)) res.status = ENGINE_ALREADY_SOLVED;
+		else if (!objectHasPuzzle[pos]) {
+			res.status = ENGINE_NO_PUZZLE;
+			if (puzzleGivesItem(gs, pos)) {
+				engineGiveItem(gs, pos, res);
+				engineSolve(gs, pos, res);
+			}
+		}
+		else res.status = ENGINE_PUZZLE;
+		break;
+	case CMD_ANSWER:
+		if (isObjectSolved(gs, pos)) { res.status = ENGINE_ALREADY_SOLVED; break; }
+		if (!objectHasPuzzle[pos] || !cmd.text) { res.status = ENGINE_INVALID; break; }
+		if (checkPuzzleAnswerByIndex(gs, pos, cmd.text, strlen(cmd.text))) {
+			engineSolve(gs, pos, res);
+			engineGiveItem(gs, pos, res);
+		}
+		else res.status = ENGINE_WRONG_ANSWER;
+		break;
+	case CMD_HINT:
+		if (isObjectSolved(gs, pos)) { res.status = ENGINE_ALREADY_SOLVED; break; }
+		if (!objectHasPuzzle[pos]) { res.status = ENGINE_NO_PUZZLE; break; }
+		puzzleHintText(gs, pos, res.hint, (int)sizeof(res.hint));
+		++gs.hintsUsed;
+		res.hintsDelta = 1;
+		break;
+	case CMD_USE_ITEM: {
+		int effect = findInteraction(gs.inventory[cmd.item], pos);
+		if (!(effect & USE_UNLOCK)) { res.status = ENGINE_NO_EFFECT; break; }
+		if (isObjectSolved(gs, pos)) { res.status = ENGINE_ALREADY_SOLVED; break; }
+		// unlocking counts as solving: the object hands over its item too
+		engineSolve(gs, pos, res);
+		engineGiveItem(gs, pos, res);
+		if (effect & USE_CONSUME) {
+			removeInventoryAt(gs, cmd.item);
+			res.itemRemoved = cmd.item;
+		}
+		break;
+	}
+	case CMD_DISCARD_ITEM:
+		removeInventoryAt(gs, cmd.item);
+		res.itemRemoved = cmd.item;
+		break;
+	case CMD_SAVE:
+		if (!writeSaveFile(gs)) res.status = ENGINE_IO_ERROR;
+		break;
+	}
+	res.roomIndex = gs.currentRoomIndex;
+	return res.status != ENGINE_INVALID && res.status != ENGINE_IO_ERROR;
+}
+
+/* ========== Console front end ========== */
+
+EngineResult engineApplySimple(GameSession &gs, EngineCommandType type, int object, int item, const char* text) {
+	EngineCommand cmd;
+	cmd.type = type;
+	cmd.object = object;
+	cmd.item = item;
+	cmd.text = text;
+	EngineResult res;
+	engineApply(gs, cmd, res);
+	return res;
+}
+
+void printItemGained(GameSession &gs, const EngineResult &res, ostream &out) {
+	if (res.itemGained >= 0) out << "Added to inventory: " << puzzleItemName(gs, res.itemGained) << "\n";
+}
+
+Task<void> inspectObjectInRoom(GameSession &gs, PlayerIO &io, int roomIdx, int localIndex) {
+	ostream &out = *io.out;
+	EngineResult res = engineApplySimple(gs, CMD_INSPECT, localIndex, -1, nullptr);
+	int pos = roomObjectStart[roomIdx] + localIndex;
+	clearScreen();
+	out << "Inspecting: " << objectNames[pos] << "\n\n";
+	out << objectDescriptions[pos] << "\n\n";
+	if (res.status == ENGINE_ALREADY_SOLVED) {
+		out << "(Already solved)\n";
+		co_await askEnter(io);
+		co_return;
+	}
+	if (res.status == ENGINE_NO_PUZZLE) {
+		out << "No puzzle here.\n";
+		printItemGained(gs, res, out);
+		co_await askEnter(io);
+		co_return;
+	}
+	out << "Puzzle prompt:\n";
+	if (strlen(puzzlePrompt(gs, pos)) > 0) out << puzzlePrompt(gs, pos) << "\n\n";
+	else out << "(No prompt available)\n\n";
+	out << "Options:\n1. Try to solve\n2. Ask for a hint (penalty)\n3. Back\nChoose: ";
+	int choice = co_await askIntInRange(io, 1, 3);
+	if (choice == 2) {
+		res = engineApplySimple(gs, CMD_HINT, localIndex, -1, nullptr);
+		out << "HINT: " << res.hint << "\n";
+		co_await askEnter(io);
+		co_return;
+	}
+	else if (choice == 3) {
+		co_return;
+	}
+	out << "Enter your answer: ";
+	string user = co_await askLine(io);
+	if (user.size() == 0) {
+		out << "No answer entered.\n";
+		co_await askEnter(io);
+		co_return;
+	}
+	res = engineApplySimple(gs, CMD_ANSWER, localIndex, -1, user.c_str());
+	if (res.status == ENGINE_OK) {
+		out << "Correct! Puzzle solved.\n";
+		printItemGained(gs, res, out);
+	}
+	else {
+		out << "Incorrect answer. Try again later.\n";
+	}
+	co_await askEnter(io);
+}
+
+/* ========== Frame renderer ========== */
+
+// The parts of a room view that only change with the catalog, built once per
+// room when the rooms load: the header up to the timer, the ASCII layout and
+// the numbered object labels. The text lives in the catalog arena like the
+// rooms' own, so a reload copies an unchanged room's layout as three pointers.
+struct RoomLayout {
+	const char* header;          // "Room: <name>    Time: "
+	const char* body;            // layout and the "Objects:" heading
+	const char* labels;          // "1. <name>\n2. <name>\n..."
+};
+
+thread_local CatalogVector<RoomLayout> roomLayouts;
+bool ansiScreen = false; // --ansi: redraw room views in place with escape sequences
+const int FRAME_MAX_DIFF_LINES = 24; // taller frames may have scrolled: redraw them whole
+
+void releaseRoomLayouts() {
+	vector<RoomLayout>().swap(*roomLayouts);
+}
+
+void buildRoomLayout(int r) {
+	string t;
+	RoomLayout &L = roomLayouts[r];
+	int start = roomObjectStart[r], cnt = roomObjectCount[r];
+	t = string("Room: ") + roomNames[r] + "    Time: ";
+	L.header = arenaCopy(catalogArena, t.data(), t.size());
+	t = "\nRoom Layout (ASCII visual)\n---------------------------\n[ Door ]              [ ";
+	t += cnt > 0 ? objectNames[start] : " ";
+	t += " ]\n";
+	if (cnt > 1) t += string("[ Shelf ]          [ ") + objectNames[start + 1] + " ]\n";
+	t += "---------------------------\n\nObjects:\n";
+	L.body = arenaCopy(catalogArena, t.data(), t.size());
+	t.clear();
+	for (int i = 0; i < cnt; ++i) {
+		t += to_string(i + 1) + ". " + objectNames[start + i];
+		t += '\n';
+	}
+	L.labels = arenaCopy(catalogArena, t.data(), t.size());
+}
+
+void prepareRoomLayouts() {
+	roomLayouts->assign((size_t)totalRooms, RoomLayout{ "", "", "" });
+}
+
+void buildRoomLayouts() {
+	prepareRoomLayouts();
+	for (int r = 0; r < totalRooms; ++r) buildRoomLayout(r);
+}
+
+void appendInt(string &f, int v) {
+	char num[16];
+	int len = sprintf_s(num, sizeof(num), "%d", v);
+	if (len > 0) f.append(num, (size_t)len);
+}
+
+// Room header, layout, object list and the command prompt (the last line).
+void composeRoomView(GameSession &gs, int r, string &f) {
+	const RoomLayout &L = roomLayouts[r];
+	f.clear();
+	f += L.header;
+	appendInt(f, gs.accumulatedElapsed + (int)difftime(time(nullptr), gs.startTime));
+	f += " sec\n";
+	f += L.body;
+	const char* label = L.labels;
+	for (int i = 0; i < roomObjectCount[r]; ++i) {
+		const char* eol = strchr(label, '\n');
+		f.append(label, (size_t)(eol - label));
+		label = eol + 1;
+		if (isObjectSolved(gs, roomObjectStart[r] + i)) f += " (solved)";
+		f += '\n';
+	}
+	f += "I. Inventory (";
+	appendInt(f, gs.invCount);
+	f += ")\nS. Save Game\nQ. Quit to Main Menu\n\nEnter choice (number/I/S/Q): ";
+}
+
+void splitFrameLines(const string &f, vector<uint32_t> &lines) {
+	lines.clear();
+	lines.push_back(0);
+	for (size_t i = 0; i < f.size(); ++i) if (f[i] == '\n') lines.push_back((uint32_t)(i + 1));
+}
+
+bool frameLineEquals(const string &a, const vector<uint32_t> &al, const string &b, const vector<uint32_t> &bl, size_t i) {
+	size_t aEnd = i + 1 < al.size() ? al[i + 1] : a.size();
+	size_t bEnd = i + 1 < bl.size() ? bl[i + 1] : b.size();
+	return aEnd - al[i] == bEnd - bl[i] && memcmp(a.data() + al[i], b.data() + bl[i], aEnd - al[i]) == 0;
+}
+
+// Appends "move to row, write line i, clear the rest of the row".
+void appendFrameLine(string &o, const string &f, const vector<uint32_t> &lines, size_t i, const char* clearTo) {
+	size_t end = i + 1 < lines.size() ? lines[i + 1] - 1 : f.size();
+	o += "\x1B[";
+	appendInt(o, (int)i + 1);
+	o += ";1H";
+	o.append(f, lines[i], end - lines[i]);
+	o += clearTo;
+}
+
+// Writes the composed frame with one call. In ANSI mode an undisturbed
+// previous frame of the same height is patched line by line instead; the
+// prompt line is always rewritten, which also erases the player's echo.
+void presentFrame(PlayerIO &io) {
+	FrameRenderer &fr = io.screen;
+	ostream &out = *io.out;
+	if (!ansiScreen || io.network || io.dryRun) {
+		out.write(fr.frame.data(), (streamsize)fr.frame.size());
+		out.flush();
+		return;
+	}
+	splitFrameLines(fr.frame, fr.frameLines);
+	size_t n = fr.frameLines.size();
+	string &o = fr.ansi;
+	o.clear();
+	if (fr.onScreen && n == fr.shownLines.size() && n <= (size_t)FRAME_MAX_DIFF_LINES) {
+		for (size_t i = 0; i + 1 < n; ++i) {
+			if (!frameLineEquals(fr.frame, fr.frameLines, fr.shown, fr.shownLines, i)) appendFrameLine(o, fr.frame, fr.frameLines, i, "\x1B[K");
+		}
+		appendFrameLine(o, fr.frame, fr.frameLines, n - 1, "\x1B[J");
+	}
+	else {
+		o += "\x1B[H\x1B[2J";
+		o += fr.frame;
+	}
+	out.write(o.data(), (streamsize)o.size());
+	out.flush();
+	swap(fr.shown, fr.frame);
+	swap(fr.shownLines, fr.frameLines);
+	fr.onScreen = true;
+}
+
+// Lets the terminal interpret the escape sequences (Windows consoles need asking).
+void enableAnsiScreen() {
+#ifdef _WIN32
+	HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+	DWORD mode = 0;
+	if (h != INVALID_HANDLE_VALUE && GetConsoleMode(h, &mode)) SetConsoleMode(h, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
+}
+
+/* ========== Catalog versions ========== */
+
+// A loaded catalog. The catalog globals are a per-thread view of one of
+// these: loaders fill the view and captureCatalog stores it, bindCatalog
+// points a thread's view at a version. A published version is read-only and
+// shared by pointer; every session holds the one it plays and the last
+// holder frees it, so a hot reload never pulls a catalog from under a game.
+// Text is owned apart from the tables because a reloaded version keeps
+// pointing into the text of the rooms that did not change.
+struct CatalogText {
+	StringArena arena = { nullptr, 0, 0, ARENA_FIRST_BLOCK, 0, 0, 0 };
+	MappedFile pack = MappedFile();
+	bool packMapped = false;
+
+	~CatalogText() {
+		arenaRelease(arena);
+		if (packMapped) unmapFile(pack);
+	}
+};
+
+struct Catalog {
+	uint64_t version = 0; // 1 for the catalog loaded at start-up, +1 per reload
+
+	int totalRooms = 0;
+	char** roomNames = nullptr;
+	char** roomDescriptions = nullptr;
+	int* roomObjectCount = nullptr;
+	int* roomObjectStart = nullptr;
+
+	int totalObjects = 0;
+	char** objectNames = nullptr;
+	char** objectDescriptions = nullptr;
+	int* objectHasPuzzle = nullptr;
+	int* objectPuzzleType = nullptr;
+	char** objectPuzzlePrompt = nullptr;
+	char** objectPuzzleAnswer = nullptr;
+	int* objectGivesItem = nullptr;
+	char** objectItemName = nullptr;
+
+	int totalInteractions = 0;
+	char** interactionItemName = nullptr;
+	int* interactionObject = nullptr;
+	int* interactionEffect = nullptr;
+
+	int totalItems = 0;
+	const char** itemNames = nullptr;
+	int* objectItemId = nullptr;
+	int* itemTable = nullptr;
+	size_t itemTableMask = 0;
+
+	vector<AnswerMatcher> answerMatchers;
+	vector<AnswerRange> answerRanges;
+	vector<AnswerDfa> answerDfas;
+	vector<AnswerEntry> answerTable;
+	vector<AnswerText> answerTexts;
+	vector<InteractionEntry> interactionTable;
+	vector<RoomLayout> roomLayouts;
+	vector<uint64_t> roomHashes;
+
+	shared_ptr<CatalogText> text = make_shared<CatalogText>();
+	vector<shared_ptr<CatalogText>> borrowedText; // older versions' text this one points into
+
+	~Catalog();
+};
+
+// Points this thread's catalog globals at 'c' (nullptr: at nothing).
+void bindCatalog(Catalog* c) {
+	boundCatalog = c;
+	if (!c) {
+		totalRooms = totalObjects = totalInteractions = totalItems = 0;
+		roomNames = roomDescriptions = nullptr;
+		roomObjectCount = roomObjectStart = nullptr;
+		objectNames = objectDescriptions = objectPuzzlePrompt = objectPuzzleAnswer = objectItemName = nullptr;
+		objectHasPuzzle = objectPuzzleType = objectGivesItem = nullptr;
+		interactionItemName = nullptr;
+		interactionObject = interactionEffect = nullptr;
+		itemNames = nullptr;
+		objectItemId = itemTable = nullptr;
+		itemTableMask = 0;
+		answerMatchers.v = nullptr;
+		answerRanges.v = nullptr;
+		answerDfas.v = nullptr;
+		answerTable.v = nullptr;
+		answerTexts.v = nullptr;
+		interactionTable.v = nullptr;
+		roomLayouts.v = nullptr;
+		roomHashes.v = nullptr;
+		catalogArena = StringArena{ nullptr, 0, 0, ARENA_FIRST_BLOCK, 0, 0, 0 };
+		catalogPack = MappedFile();
+		catalogPackMapped = false;
+		return;
+	}
+	totalRooms = c->totalRooms;
+	roomNames = c->roomNames;
+	roomDescriptions = c->roomDescriptions;
+	roomObjectCount = c->roomObjectCount;
+	roomObjectStart = c->roomObjectStart;
+
+	totalObjects = c->totalObjects;
+	objectNames = c->objectNames;
+	objectDescriptions = c->objectDescriptions;
+	objectHasPuzzle = c->objectHasPuzzle;
+	objectPuzzleType = c->objectPuzzleType;
+	objectPuzzlePrompt = c->objectPuzzlePrompt;
+	objectPuzzleAnswer = c->objectPuzzleAnswer;
+	objectGivesItem = c->objectGivesItem;
+	objectItemName = c->objectItemName;
+
+	totalInteractions = c->totalInteractions;
+	interactionItemName = c->interactionItemName;
+	interactionObject = c->interactionObject;
+	interactionEffect = c->interactionEffect;
+
+	totalItems = c->totalItems;
+	itemNames = c->itemNames;
+	objectItemId = c->objectItemId;
+	itemTable = c->itemTable;
+	itemTableMask = c->itemTableMask;
+
+	answerMatchers.v = &c->answerMatchers;
+	answerRanges.v = &c->answerRanges;
+	answerDfas.v = &c->answerDfas;
+	answerTable.v = &c->answerTable;
+	answerTexts.v = &c->answerTexts;
+	interactionTable.v = &c->interactionTable;
+	roomLayouts.v = &c->roomLayouts;
+	roomHashes.v = &c->roomHashes;
+
+	catalogArena = c->text->arena;
+	catalogPack = c->text->pack;
+	catalogPackMapped = c->text->packMapped;
+}
+
+// Stores this thread's view into 'c' after the loaders changed it.
+void captureCatalog(Catalog &c) {
+	c.totalRooms = totalRooms;
+	c.roomNames = roomNames;
+	c.roomDescriptions = roomDescriptions;
+	c.roomObjectCount = roomObjectCount;
+	c.roomObjectStart = roomObjectStart;
+
+	c.totalObjects = totalObjects;
+	c.objectNames = objectNames;
+	c.objectDescriptions = objectDescriptions;
+	c.objectHasPuzzle = objectHasPuzzle;
+	c.objectPuzzleType = objectPuzzleType;
+	c.objectPuzzlePrompt = objectPuzzlePrompt;
+	c.objectPuzzleAnswer = objectPuzzleAnswer;
+	c.objectGivesItem = objectGivesItem;
+	c.objectItemName = objectItemName;
+
+	c.totalInteractions = totalInteractions;
+	c.interactionItemName = interactionItemName;
+	c.interactionObject = interactionObject;
+	c.interactionEffect = interactionEffect;
+
+	c.totalItems = totalItems;
+	c.itemNames = itemNames;
+	c.objectItemId = objectItemId;
+	c.itemTable = itemTable;
+	c.itemTableMask = itemTableMask;
+
+	c.text->arena = catalogArena;
+	c.text->pack = catalogPack;
+	c.text->packMapped = catalogPackMapped;
+}
+
+Catalog::~Catalog() {
+	Catalog* prev = boundCatalog;
+	bindCatalog(this);
+	releaseCatalogTables();
+	bindCatalog(prev == this ? nullptr : prev);
+}
+
+// Binds a new, empty catalog for this thread's loaders to fill.
+void beginCatalog() {
+	Catalog* c = new(nothrow) Catalog();
+	if (!c) { cerr << "Memory alloc failed\n"; exit(1); }
+	bindCatalog(c);
+}
+
+// Takes the catalog the loaders filled since beginCatalog; a failed one is
+// freed and nullptr returned.
+shared_ptr<Catalog> finishCatalog(bool ok) {
+	Catalog* c = boundCatalog;
+	captureCatalog(*c);
+	shared_ptr<Catalog> owned(c);
+	if (!ok) owned.reset();
+	return owned;
+}
+
+// The version new sessions start on; swapped whole by publishCatalog.
+mutex liveCatalogMutex;
+shared_ptr<Catalog> liveCatalogVersion;
+uint64_t catalogVersionCount = 0;
+
+shared_ptr<Catalog> liveCatalog() {
+	lock_guard<mutex> lk(liveCatalogMutex);
+	return liveCatalogVersion;
+}
+
+void publishCatalog(const shared_ptr<Catalog> &c) {
+	lock_guard<mutex> lk(liveCatalogMutex);
+	c->version = ++catalogVersionCount;
+	liveCatalogVersion = c;
+}
+
+// Moves a session onto the live catalog between games. Item ids can change
+// from one version to the next, so the last game's items go over by name.
+void adoptLiveCatalog(GameSession &gs) {
+	shared_ptr<Catalog> live = liveCatalog();
+	if (!live || live == gs.catalog) return;
+	vector<string> items;
+	for (int i = 0; i < gs.lastItemsCount; ++i) items.push_back(itemNames[gs.lastItemsCollected[i]]);
+	if (gs.objectSolvedBits) { delete[] gs.objectSolvedBits; gs.objectSolvedBits = nullptr; }
+	if (gs.roomUnsolvedCount) { delete[] gs.roomUnsolvedCount; gs.roomUnsolvedCount = nullptr; }
+	if (gs.puzzleSource) { delete[] gs.puzzleSource; gs.puzzleSource = nullptr; }
+	if (gs.itemHeldBits) { delete[] gs.itemHeldBits; gs.itemHeldBits = nullptr; }
+	if (!allocSession(gs)) exit(1);
+	int kept = 0;
+	for (size_t i = 0; i < items.size(); ++i) {
+		int id = findItemId(items[i].data(), items[i].size());
+		if (id >= 0) gs.lastItemsCollected[kept++] = id;
+	}
+	gs.lastItemsCount = kept;
+}
+
+/* ========== Hot reload ========== */
+
+// --watch (console and server) watches rooms.txt and publishes a new catalog
+// version when it changes. Every room's block of text is hashed; a room
+// whose hash matches a room of the live version (at any position, so
+// inserting a room moves the ones after it instead of re-reading them) gets
+// that room's strings, objects, rules, matchers and layout copied with its
+// object indices shifted, and only the other rooms are parsed and compiled.
+// Sessions move to the new version at the main menu and when a game starts
+// or is loaded (adoptLiveCatalog).
+bool watchCatalog = false;
+const int WATCH_SETTLE_MS = 200;  // editors write in steps: reload once the file is quiet
+const int WATCH_POLL_MS = 500;    // stat() interval where inotify is not available
+
+atomic<bool> watcherStop{ false };
+thread watcherThread;
+
+enum ReloadResult { RELOAD_OK, RELOAD_UNCHANGED, RELOAD_FULL, RELOAD_FAILED };
+
+// Copies old object 'from''s matcher to object 'to' of the catalog being built.
+void copyAnswerMatcher(const Catalog &old, int from, int to) {
+	AnswerMatcher m = old.answerMatchers[from];
+	if (m.type == PT_NUMBER || m.type == PT_RANGE) {
+		int first = (int)answerRanges.size();
+		answerRanges->insert(answerRanges->end(), old.answerRanges.begin() + m.first, old.answerRanges.begin() + m.first + m.count);
+		m.first = first;
+	}
+	else if (m.type == PT_PATTERN) {
+		answerDfas->push_back(old.answerDfas[m.dfa]);
+		m.dfa = (int)answerDfas.size() - 1;
+	}
+	else if (m.type == PT_TEXT) {
+		int first = (int)answerTexts.size();
+		for (int k = m.first; k < m.first + m.count; ++k) {
+			addCompiledTextAnswer(to, old.answerTexts[k].text, old.answerTexts[k].len);
+			answerTexts->push_back(old.answerTexts[k]);
+		}
+		if (m.count == 0) addTextAnswer(to, "", 0);
+		m.first = first;
+	}
+	answerMatchers[to] = m;
+}
+
+// Builds the catalog bound on this thread from 'fname', reusing the rooms of
+// 'old' whose text is unchanged. RELOAD_FULL means the file has to be parsed
+// from scratch (the live version has no room hashes, or a ROOM line turned
+// out to be a field value).
+ReloadResult reloadRoomsFromFile(const Catalog &old, const char* fname, int &parsed) {
+	if (old.roomHashes.size() != (size_t)old.totalRooms) return RELOAD_FULL;
+	MappedFile mf;
+	if (!mapFileReadOnly(fname, mf)) return RELOAD_FAILED;
+	TextCursor cur;
+	cur.p = mf.data;
+	cur.end = mf.data + mf.size;
+	const char* end = cur.end;
+	int foundTotal = readRoomCount(cur);
+	if (foundTotal <= 0) { unmapFile(mf); return RELOAD_FAILED; }
+	roomNames = new(nothrow) char*[foundTotal];
+	roomDescriptions = new(nothrow) char*[foundTotal];
+	roomObjectCount = new(nothrow) int[foundTotal];
+	roomObjectStart = new(nothrow) int[foundTotal];
+	if (!roomNames || !roomDescriptions || !roomObjectCount || !roomObjectStart) { cerr << "Memory alloc failed\n"; unmapFile(mf); return RELOAD_FAILED; }
+	totalRooms = foundTotal;
+	int threads = parseThreads > 0 ? parseThreads : (int)thread::hardware_concurrency();
+	if (threads < 1 || mf.size < PARALLEL_PARSE_MIN_BYTES) threads = 1;
+
+	// 1. blocks and their hashes; each block is matched to an old room
+	vector<const char*> roomAt;
+	int rooms = findRoomBlocks(mf, cur, threads, roomAt);
+	roomHashes->assign((size_t)totalRooms, 0);
+	uint64_t* hashes = roomHashes.data();
+	runOnThreads(threads, [&](int t) {
+		for (int r = (int)((long long)rooms * t / threads); r < (int)((long long)rooms * (t + 1) / threads); ++r)
+			hashes[r] = roomTextHash(roomAt[r], (size_t)(roomAt[r + 1] - roomAt[r]));
+	});
+	vector<int> source((size_t)rooms, -1);
+	unordered_map<uint64_t, int> oldByHash;
+	bool unchanged = totalRooms == old.totalRooms;
+	for (int r = 0; r < rooms; ++r) {
+		if (r < old.totalRooms && old.roomHashes[r] == hashes[r]) { source[r] = r; continue; }
+		unchanged = false;
+		if (oldByHash.empty())
+			for (int o = old.totalRooms - 1; o >= 0; --o) if (old.roomHashes[o] != 0) oldByHash[old.roomHashes[o]] = o;
+		unordered_map<uint64_t, int>::iterator it = oldByHash.find(hashes[r]);
+		if (it != oldByHash.end()) source[r] = it->second;
+	}
+	for (int o = rooms; o < old.totalRooms && unchanged; ++o) if (old.roomHashes[o] != 0) unchanged = false;
+	if (unchanged) { unmapFile(mf); return RELOAD_UNCHANGED; }
+
+	// 2. object counts (kept for reused rooms), then their prefix sum
+	long long objects = 0;
+	for (int r = 0; r < rooms; ++r) {
+		int count;
+		if (source[r] >= 0) count = old.roomObjectCount[source[r]];
+		else {
+			TextCursor c;
+			c.p = roomAt[r];
+			c.end = end;
+			const char* s = nullptr;
+			size_t n = 0;
+			nextLine(c, s, n); // ROOM
+			readFieldLine(c, s, n, "");
+			readFieldLine(c, s, n, "");
+			count = readObjectCount(c);
+		}
+		roomObjectStart[r] = (int)objects;
+		roomObjectCount[r] = count;
+		objects += count;
+	}
+	if (objects > INT_MAX) { unmapFile(mf); return RELOAD_FULL; }
+	int objCap = 0;
+	if (objects > 0) ensureObjectCapacity((int)objects, objCap);
+	char* emptyText = arenaCopy(catalogArena, "", 0);
+	for (int r = rooms; r < totalRooms; ++r) {
+		roomNames[r] = emptyText;
+		roomDescriptions[r] = emptyText;
+		roomObjectStart[r] = (int)objects;
+		roomObjectCount[r] = 0;
+	}
+
+	// old item rules grouped by room, each room's in file order
+	vector<int> ruleStart((size_t)old.totalRooms + 1, 0);
+	vector<int> ruleRoom((size_t)old.totalInteractions);
+	vector<int> rules((size_t)old.totalInteractions);
+	for (int k = 0; k < old.totalInteractions; ++k) {
+		int o = (int)(upper_bound(old.roomObjectStart, old.roomObjectStart + old.totalRooms, old.interactionObject[k]) - old.roomObjectStart) - 1;
+		ruleRoom[k] = o;
+		++ruleStart[o + 1];
+	}
+	for (int o = 0; o < old.totalRooms; ++o) ruleStart[o + 1] += ruleStart[o];
+	vector<int> filled(ruleStart.begin(), ruleStart.end() - 1);
+	for (int k = 0; k < old.totalInteractions; ++k) rules[filled[ruleRoom[k]]++] = k;
+
+	// 3. rooms in order: copied, or parsed from their block
+	int useCap = 0;
+	parsed = 0;
+	for (int r = 0; r < rooms; ++r) {
+		int first = roomObjectStart[r], count = roomObjectCount[r];
+		int o = source[r];
+		if (o >= 0) {
+			int from = old.roomObjectStart[o];
+			roomNames[r] = old.roomNames[o];
+			roomDescriptions[r] = old.roomDescriptions[o];
+			for (int k = 0; k < count; ++k) {
+				objectNames[first + k] = old.objectNames[from + k];
+				objectDescriptions[first + k] = old.objectDescriptions[from + k];
+				objectHasPuzzle[first + k] = old.objectHasPuzzle[from + k];
+				objectPuzzleType[first + k] = old.objectPuzzleType[from + k];
+				objectPuzzlePrompt[first + k] = old.objectPuzzlePrompt[from + k];
+				objectPuzzleAnswer[first + k] = old.objectPuzzleAnswer[from + k];
+				objectGivesItem[first + k] = old.objectGivesItem[from + k];
+				objectItemName[first + k] = old.objectItemName[from + k];
+			}
+			for (int j = ruleStart[o]; j < ruleStart[o + 1]; ++j) {
+				int k = rules[j];
+				ensureInteractionCapacity(totalInteractions + 1, useCap);
+				interactionItemName[totalInteractions] = old.interactionItemName[k];
+				interactionObject[totalInteractions] = old.interactionObject[k] - from + first;
+				interactionEffect[totalInteractions] = old.interactionEffect[k];
+				++totalInteractions;
+			}
+			continue;
+		}
+		TextCursor c;
+		c.p = roomAt[r];
+		c.end = end;
+		const char* s = nullptr;
+		size_t n = 0;
+		nextLine(c, s, n); // ROOM
+		parseRoomBody(catalogArena, c, r, first, count, nullptr);
+		if (c.p > roomAt[r + 1]) { unmapFile(mf); return RELOAD_FULL; }
+		c.end = roomAt[r + 1];
+		while (nextNonEmptyLine(c, s, n)) {
+			if (spanIStartsWith(s, n, "USE ")) parseInteractionLine(r, s, n, useCap);
+		}
+		++parsed;
+	}
+	totalObjects = (int)objects;
+	unmapFile(mf);
+
+	// 4. lookup tables: items are numbered as a full load numbers them and
+	// the rule table is rebuilt; matchers and layouts of reused rooms are copied
+	if (!buildItemDictionary()) return RELOAD_FAILED;
+	compileInteractionTable();
+	size_t textAnswers = 0;
+	for (int r = 0; r < rooms; ++r) {
+		for (int k = 0; k < roomObjectCount[r]; ++k) {
+			int i = roomObjectStart[r] + k;
+			if (source[r] < 0) { textAnswers += countAnswerAlternatives(i); continue; }
+			const AnswerMatcher &m = old.answerMatchers[old.roomObjectStart[source[r]] + k];
+			if (m.type == PT_TEXT) textAnswers += (size_t)m.count + 1;
+		}
+	}
+	prepareAnswerMatchers(textAnswers);
+	prepareRoomLayouts();
+	for (int r = 0; r < totalRooms; ++r) {
+		int o = r < rooms ? source[r] : -1;
+		for (int k = 0; k < roomObjectCount[r]; ++k) {
+			if (o >= 0) copyAnswerMatcher(old, old.roomObjectStart[o] + k, roomObjectStart[r] + k);
+			else compileAnswerMatcher(roomObjectStart[r] + k);
+		}
+		if (o >= 0) roomLayouts[r] = old.roomLayouts[o];
+		else if (r > rooms) roomLayouts[r] = roomLayouts[rooms]; // rooms missing from the file look alike
+		else buildRoomLayout(r);
+	}
+	return RELOAD_OK;
+}
+
+// Reload notices: printed as they happen, or with holdCatalogNotices (the
+// console) kept for the player's next menu so they don't land mid-prompt.
+bool holdCatalogNotices = false;
+string heldCatalogNotices; // guarded by liveCatalogMutex
+
+void postCatalogNotice(const string &s) {
+	if (!holdCatalogNotices) { cout << s; return; }
+	lock_guard<mutex> lk(liveCatalogMutex);
+	heldCatalogNotices += s;
+}
+
+string takeCatalogNotices() {
+	lock_guard<mutex> lk(liveCatalogMutex);
+	string s;
+	s.swap(heldCatalogNotices);
+	return s;
+}
+
+// Builds the next catalog version from rooms.txt and publishes it. The live
+// version is left alone if the file cannot be read or nothing changed.
+bool reloadCatalog() {
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	shared_ptr<Catalog> old = liveCatalog();
+	int parsed = 0;
+	beginCatalog();
+	ReloadResult res = old ? reloadRoomsFromFile(*old, ROOMS_TXT, parsed) : RELOAD_FULL;
+	if (res == RELOAD_FULL) {
+		finishCatalog(false);
+		beginCatalog();
+		res = loadRoomsFromFile(ROOMS_TXT) && compileCatalog() ? RELOAD_OK : RELOAD_FAILED;
+		parsed = totalRooms;
+		vector<RoomBlock>().swap(roomBlocks);
+	}
+	else if (res == RELOAD_OK) {
+		// the copied rooms point into the old versions' text
+		boundCatalog->borrowedText = old->borrowedText;
+		boundCatalog->borrowedText.push_back(old->text);
+	}
+	int rooms = totalRooms;
+	shared_ptr<Catalog> c = finishCatalog(res == RELOAD_OK);
+	bindCatalog(nullptr);
+	if (res == RELOAD_UNCHANGED) return false;
+	ostringstream note;
+	if (!c) {
+		note << "Reloading '" << ROOMS_TXT << "' failed; still serving catalog version " << (old ? old->version : 0) << ".\n";
+		postCatalogNotice(note.str());
+		return false;
+	}
+	publishCatalog(c);
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+	char msbuf[32]; sprintf_s(msbuf, "%.2f", ms);
+	note << "Reloaded '" << ROOMS_TXT << "' as catalog version " << c->version << ": parsed " << parsed << " of " << rooms << " room(s) in " << msbuf << " ms.\n";
+	postCatalogNotice(note.str());
+	return true;
+}
+
+// Waits for rooms.txt to change and reloads it once writes have settled.
+// inotify watches the directory, so an editor that saves by renaming a new
+// file over rooms.txt is seen too; elsewhere the file is stat()ed.
+void catalogWatcherMain() {
+	string path = ROOMS_TXT;
+	size_t slash = path.find_last_of("/\\");
+	string dir = slash == string::npos ? "." : path.substr(0, slash + 1);
+	string name = slash == string::npos ? path : path.substr(slash + 1);
+	int64_t size = 0, mtime = 0;
+	statFile(ROOMS_TXT, size, mtime);
+	bool pending = false;
+	chrono::steady_clock::time_point lastChange;
+	int fd = -1;
+#ifdef __linux__
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd >= 0 && inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE) < 0) { close(fd); fd = -1; }
+#endif
+	while (!watcherStop.load()) {
+		bool changed = false;
+#ifdef __linux__
+		if (fd >= 0) {
+			pollfd p = { fd, POLLIN, 0 };
+			if (poll(&p, 1, WATCH_SETTLE_MS / 2) > 0) {
+				alignas(inotify_event) char buf[4096];
+				ssize_t len;
+				while ((len = read(fd, buf, sizeof(buf))) > 0) {
+					for (char* q = buf; q < buf + len; ) {
+						inotify_event* ev = (inotify_event*)q;
+						if (ev->len > 0 && name == ev->name) changed = true;
+						q += sizeof(inotify_event) + ev->len;
+					}
+				}
+			}
+		}
+#endif
+		if (fd < 0) {
+			this_thread::sleep_for(chrono::milliseconds(WATCH_POLL_MS));
+			int64_t sz = 0, mt = 0;
+			if (statFile(ROOMS_TXT, sz, mt) && (sz != size || mt != mtime)) { size = sz; mtime = mt; changed = true; }
+		}
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if (changed) { pending = true; lastChange = now; }
+		if (pending && now - lastChange >= chrono::milliseconds(WATCH_SETTLE_MS)) {
+			pending = false;
+			reloadCatalog();
+		}
+	}
+#ifdef __linux__
+	if (fd >= 0) close(fd);
+#endif
+}
+
+void startCatalogWatcher() {
+	watcherStop = false;
+	watcherThread = thread(catalogWatcherMain);
+	cout << "Watching '" << ROOMS_TXT << "' for changes.\n";
+}
+
+// Also rebinds this thread to the live version: the one it loaded at start-up
+// may have been freed since.
+void stopCatalogWatcher() {
+	if (!watcherThread.joinable()) return;
+	watcherStop = true;
+	watcherThread.join();
+	bindCatalog(liveCatalog().get());
+}
+
+/* ========== Room play loop ========== */
+
+// Announces an unlocked door; returns true when the room loop should exit.
+Task<bool> announceRoomCompleted(GameSession &gs, PlayerIO &io, int r) {
+	if (!isRoomCompleted(gs, r)) co_return false;
+	ostream &out = *io.out;
+	out << "\n🎉 All objects in this room are solved! Door unlocked!\n";
+	if (r < totalRooms - 1) {
+		out << "Moving to next room...\n";
+	}
+	else {
+		out << "Final room completed! You've escaped!\n";
+	}
+	co_await askEnter(io);
+	co_return true;
+}
+
+Task<void> playRoomLoop(GameSession &gs, PlayerIO &io, int r) {
+	ostream &out = *io.out;
+	if (!ensureRoomLoaded(r)) {
+		// the game cannot go on, but what the player has done is kept
+		if (!io.network && !io.dryRun) {
+			EngineResult res = engineApplySimple(gs, CMD_SAVE, -1, -1, nullptr);
+			reportSave(res.status == ENGINE_OK, out);
+		}
+		out << "Restart the game to play the current rooms.\n";
+		gs.exitToMainRequested = true;
+		co_await askEnter(io);
+		co_return;
+	}
+	prefetchRoom(r + 1);
+	io.screen.onScreen = false;
+	while (true) {
+		if (!io.network && !io.dryRun) maybeAutosave(gs);
+		clearScreen();
+		composeRoomView(gs, r, io.screen.frame);
+		presentFrame(io);
+		string cmd = co_await askLine(io);
+		if (cmd.size() == 0) continue;
+		// anything but a bare Enter prints over the frame
+		io.screen.onScreen = false;
+		if ((cmd == "I") || (cmd == "i")) {
+			showInventory(gs, out);
+			if (gs.invCount > 0) {
+				out << "Do you want to use an item? (y/n): ";
+				if (co_await askYesNo(io)) {
+					out << "Enter item number to use: ";
+					int idx = co_await askIntInRange(io, 1, gs.invCount) - 1;
+					if (idx < 0 || idx >= gs.invCount) { out << "Invalid index.\n"; co_await askEnter(io); continue; }
+					if (roomObjectCount[r] == 0) {
+						out << "No objects in this room to use item on.\n";
+						co_await askEnter(io);
+						continue;
+					}
+					out << "Choose target object to use this on (1-" << roomObjectCount[r] << "): ";
+					int targ = co_await askIntInRange(io, 1, roomObjectCount[r]) - 1;
+					const char* itemName = itemNames[gs.inventory[idx]];
+					EngineResult res = engineApplySimple(gs, CMD_USE_ITEM, targ, idx, nullptr);
+					if (res.status == ENGINE_OK) {
+						out << "The " << itemName << " unlocks the " << objectNames[res.objectIndex] << "!\n";
+						if (res.itemRemoved >= 0) out << "The " << itemName << " is used up.\n";
+						printItemGained(gs, res, out);
+					}
+					else if (res.status == ENGINE_ALREADY_SOLVED) {
+						out << "The " << objectNames[res.objectIndex] << " is already open.\n";
+					}
+					else {
+						out << "Using the item had no noticeable effect.\n";
+					}
+				}
+			}
+			co_await askEnter(io);
+			if (co_await announceRoomCompleted(gs, io, r)) co_return;
+			continue;
+		}
+		else if ((cmd == "S") || (cmd == "s")) {
+			// one save slot per process: server players cannot share it
+			if (io.network) out << "Saving is not available on the server.\n";
+			else if (!io.dryRun) {
+				EngineResult res = engineApplySimple(gs, CMD_SAVE, -1, -1, nullptr);
+				reportSave(res.status == ENGINE_OK, out);
+			}
+			co_await askEnter(io);
+			continue;
+		}
+		else if ((cmd == "Q") || (cmd == "q")) {
+			out << "Quit to main menu? (y/n): ";
+			if (co_await askYesNo(io)) {
+				if (!io.network && !io.dryRun) reportSaveFailure(out);
+				// signal outer loops to stop and return to main menu
+				gs.exitToMainRequested = true;
+				co_return;
+			}
+			else continue;
+		}
+		else {
+			bool allDigits = true;
+			for (size_t i = 0; i < cmd.size(); ++i) if (!isdigit((unsigned char)cmd[i])) { allDigits = false; break; }
+			if (!allDigits) { out << "Invalid command.\n"; co_await askEnter(io); continue; }
+			int num = safeAtoi(cmd.c_str());
+			if (num < 1 || num > roomObjectCount[r]) { out << "Invalid object number.\n"; co_await askEnter(io); continue; }
+			co_await inspectObjectInRoom(gs, io, r, num - 1);
+
+			// Check if room is completed after solving an object
+			if (co_await announceRoomCompleted(gs, io, r)) co_return; // Exit room loop to proceed to next room
+		}
+	}
+}
+
+/* ========== Save / Load binary ========== */
+
+// Save versions: 1 = one byte per object flag, 2 = solved flags as packed 32-bit words,
+// 3 = version 2 plus the snapshot generation its SAVE_JOURNAL must carry,
+// 4 = version 3 plus the puzzle layout seed, 5 = inventory as item ids,
+// 6 = version 5 plus the itemDictionaryHash the ids belong to
+const unsigned char SAVE_VERSION = 6;
+
+// SAVE_JOURNAL holds a header and then one batch of records per journaled
+// save, each batch closed by a JR_COUNTERS record. Loading replays complete
+// batches only, so a save torn by a crash is dropped as a whole.
+const char SAVE_JOURNAL_MAGIC[4] = { 'E', 'S', 'C', 'J' };
+
+struct SaveJournalHeader {
+	char magic[4];
+	uint32_t generation;
+	int32_t objectCount;
+	uint32_t reserved;    // from here on only in journals of version 6 saves
+	uint64_t itemsHash;   // itemDictionaryHash, for the JR_ITEM_ID records
+};
+
+struct JournalCounters {
+	int32_t difficulty;
+	int32_t roomIndex;
+	int32_t moves;
+	int32_t hints;
+	int32_t elapsed;
+};
+
+enum SaveMode { SAVE_FULL, SAVE_JOURNALED };
+enum FsyncPolicy { FSYNC_NEVER, FSYNC_SNAPSHOT, FSYNC_ALWAYS };
+
+SaveMode saveMode = SAVE_JOURNALED;
+FsyncPolicy fsyncPolicy = FSYNC_SNAPSHOT;
+// the journal is folded into a new snapshot once it outgrows the snapshot (or this)
+const long long JOURNAL_MIN_COMPACT_BYTES = 16 * 1024;
+
+uint32_t saveGeneration = 0; // generation of the snapshot the current game is based on
+long long snapshotBytes = 0;
+long long journalBytes = 0;  // committed size of SAVE_JOURNAL; 0 = no usable journal
+
+// Writes (or appends) a whole buffer, optionally flushing it to the disk.
+bool writeFileBytes(const char* path, const void* data, size_t size, bool append, bool sync) {
+#ifdef _WIN32
+	HANDLE h = CreateFileA(path, append ? FILE_APPEND_DATA : GENERIC_WRITE, FILE_SHARE_READ, NULL, append ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (h == INVALID_HANDLE_VALUE) return false;
+	bool ok = true;
+	size_t done = 0;
+	while (ok && done < size) {
+		DWORD chunk = (DWORD)(size - done > 0x40000000 ? 0x40000000 : size - done), wrote = 0;
+		ok = WriteFile(h, (const char*)data + done, chunk, &wrote, NULL) != 0;
+		done += wrote;
+	}
+	if (ok && sync) ok = FlushFileBuffers(h) != 0;
+	return CloseHandle(h) != 0 && ok;
+#else
+	int fd = open(path, O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
+	if (fd < 0) return false;
+	bool ok = true;
+	size_t done = 0;
+	while (ok && done < size) {
+		ssize_t w = write(fd, (const char*)data + done, size - done);
+		if (w < 0 && errno == EINTR) continue;
+		ok = w > 0;
+		if (ok) done += (size_t)w;
+	}
+	if (ok && sync) ok = fsync(fd) == 0;
+	return close(fd) == 0 && ok;
+#endif
+}
+
+// Replaces 'dst' with 'tmp' in one step.
+bool replaceFile(const char* tmp, const char* dst) {
+#ifdef _WIN32
+	return MoveFileExA(tmp, dst, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return rename(tmp, dst) == 0;
+#endif
+}
+
+void putBytes(vector<char> &out, const void* p, size_t n) {
+	out.insert(out.end(), (const char*)p, (const char*)p + n);
+}
+
+void encodeSnapshot(GameSession &gs, vector<char> &out, uint32_t generation) {
+	putBytes(out, "ESCP1", 5);
+	unsigned char version = SAVE_VERSION;
+	putBytes(out, &version, 1);
+	putBytes(out, &generation, sizeof(generation));
+	putBytes(out, &gs.layoutSeed, sizeof(gs.layoutSeed));
+	unsigned char diff = (unsigned char)gs.difficultyLevel;
+	putBytes(out, &diff, 1);
+	putBytes(out, &gs.currentRoomIndex, sizeof(int));
+	putBytes(out, &gs.totalMoves, sizeof(int));
+	putBytes(out, &gs.hintsUsed, sizeof(int));
+	int elapsed = gs.accumulatedElapsed + (int)difftime(time(nullptr), gs.startTime);
+	putBytes(out, &elapsed, sizeof(int));
+	// inventory: item ids, behind the size and hash of the dictionary they index
+	putBytes(out, &totalItems, sizeof(int));
+	uint64_t itemsHash = itemDictionaryHash();
+	putBytes(out, &itemsHash, sizeof(itemsHash));
+	putBytes(out, &gs.invCount, sizeof(int));
+	if (gs.invCount > 0) putBytes(out, gs.inventory, gs.invCount * sizeof(int));
+	// object flags
+	putBytes(out, &totalObjects, sizeof(int));
+	putBytes(out, gs.objectSolvedBits, solvedWordCount() * sizeof(unsigned int));
+}
+
+// Generation of the snapshot currently on disk (0 when none or pre-journal).
+uint32_t readSnapshotGeneration() {
+	ifstream fin(SAVE_BIN, ios::binary);
+	if (!fin) return 0;
+	char head[10];
+	fin.read(head, sizeof(head));
+	if (fin.gcount() != (streamsize)sizeof(head) || strncmp(head, "ESCP1", 5) != 0 || (unsigned char)head[5] < 3) return 0;
+	uint32_t generation = 0;
+	memcpy(&generation, head + 6, sizeof(generation));
+	return generation;
+}
+
+// Saves are written by a background thread: the game thread only encodes
+// the state into a SaveJob. A job the writer has not picked up yet absorbs
+// later ones (a snapshot replaces it, journal batches are appended to it).
+struct SaveJob {
+	bool snapshot = false;     // replace SAVE_BIN and SAVE_JOURNAL via temp file + rename
+	vector<char> snapshotData;
+	vector<char> journalData;  // whole new journal after a snapshot, else bytes to append
+	bool syncSnapshot = false;
+	bool syncJournal = false;
+};
+
+mutex saveWriterMutex;
+condition_variable saveWriterCv;
+bool saveWriterStop = false;
+bool saveJobPending = false;
+bool saveWriterBusy = false;
+bool saveWriteFailed = false;
+bool saveFailureUnreported = false; // console thread: seen by writeSaveFile, not yet told to the player
+SaveJob pendingSaveJob;
+thread saveWriterThread;
+
+bool writeFileViaTemp(const char* path, const vector<char> &data, bool sync) {
+	string tmp = string(path) + ".tmp";
+	if (!writeFileBytes(tmp.c_str(), data.data(), data.size(), false, sync)) { remove(tmp.c_str()); return false; }
+	return replaceFile(tmp.c_str(), path);
+}
+
+bool writeSaveJob(const SaveJob &job) {
+	if (!job.snapshot) return writeFileBytes(SAVE_JOURNAL, job.journalData.data(), job.journalData.size(), true, job.syncJournal);
+	if (!writeFileViaTemp(SAVE_BIN, job.snapshotData, job.syncSnapshot)) return false;
+	// an old journal left behind by a failure here carries the previous generation and is ignored
+	if (job.journalData.empty()) { remove(SAVE_JOURNAL); return true; }
+	return writeFileViaTemp(SAVE_JOURNAL, job.journalData, job.syncSnapshot);
+}
+
+void saveWriterMain() {
+	unique_lock<mutex> lk(saveWriterMutex);
+	while (true) {
+		while (!saveJobPending && !saveWriterStop) saveWriterCv.wait(lk);
+		if (!saveJobPending) break; // stop requested and nothing left to write
+		SaveJob job;
+		swap(job, pendingSaveJob);
+		saveJobPending = false;
+		saveWriterBusy = true;
+		lk.unlock();
+		bool ok = writeSaveJob(job);
+		lk.lock();
+		saveWriterBusy = false;
+		if (!ok) saveWriteFailed = true;
+		saveWriterCv.notify_all();
+	}
+}
+
+void startSaveWriter() {
+	saveWriterStop = false;
+	saveWriterThread = thread(saveWriterMain);
+}
+
+// Writes whatever is still queued, then ends the writer thread.
+void stopSaveWriter() {
+	if (!saveWriterThread.joinable()) return;
+	{
+		lock_guard<mutex> lk(saveWriterMutex);
+		saveWriterStop = true;
+	}
+	saveWriterCv.notify_all();
+	saveWriterThread.join();
+}
+
+// Blocks until every queued save is on disk.
+void flushSaves() {
+	unique_lock<mutex> lk(saveWriterMutex);
+	while (saveJobPending || saveWriterBusy) saveWriterCv.wait(lk);
+}
+
+// Takes the failure of a background write, if one happened since the last call.
+bool takeSaveWriteFailure() {
+	lock_guard<mutex> lk(saveWriterMutex);
+	bool failed = saveWriteFailed;
+	saveWriteFailed = false;
+	return failed;
+}
+
+// Queues a job (or writes it right away when no writer thread is running).
+// Returns false only when the job itself could not be written; a failed
+// background write is reported by reportSave and reportSaveFailure.
+bool submitSaveJob(SaveJob &job) {
+	if (!saveWriterThread.joinable()) return writeSaveJob(job);
+	{
+		lock_guard<mutex> lk(saveWriterMutex);
+		if (saveJobPending && !job.snapshot) {
+			pendingSaveJob.journalData.insert(pendingSaveJob.journalData.end(), job.journalData.begin(), job.journalData.end());
+			pendingSaveJob.syncJournal = pendingSaveJob.syncJournal || job.syncJournal;
+		}
+		else {
+			swap(pendingSaveJob, job);
+		}
+		saveJobPending = true;
+	}
+	saveWriterCv.notify_all();
+	return true;
+}
+
+// Full rewrite of SAVE_BIN under a new generation, followed by an empty journal.
+bool writeSnapshot(GameSession &gs) {
+	if (saveGeneration == 0) saveGeneration = readSnapshotGeneration();
+	uint32_t generation = saveGeneration + 1;
+	SaveJob job;
+	job.snapshot = true;
+	job.syncSnapshot = fsyncPolicy != FSYNC_NEVER;
+	job.syncJournal = fsyncPolicy == FSYNC_ALWAYS;
+	encodeSnapshot(gs, job.snapshotData, generation);
+	saveGeneration = generation;
+	snapshotBytes = (long long)job.snapshotData.size();
+	gs.journalPending.clear();
+	gs.journalNeedsSnapshot = false;
+	journalBytes = 0;
+	if (saveMode == SAVE_JOURNALED) {
+		SaveJournalHeader h;
+		memset(&h, 0, sizeof(h));
+		memcpy(h.magic, SAVE_JOURNAL_MAGIC, 4);
+		h.generation = generation;
+		h.objectCount = totalObjects;
+		h.itemsHash = itemDictionaryHash();
+		putBytes(job.journalData, &h, sizeof(h));
+		journalBytes = sizeof(h);
+	}
+	return submitSaveJob(job);
+}
+
+// Queues the pending deltas plus the current counters as one journal batch.
+bool appendJournal(GameSession &gs) {
+	JournalCounters c;
+	c.difficulty = gs.difficultyLevel;
+	c.roomIndex = gs.currentRoomIndex;
+	c.moves = gs.totalMoves;
+	c.hints = gs.hintsUsed;
+	c.elapsed = gs.accumulatedElapsed + (int)difftime(time(nullptr), gs.startTime);
+	journalPut(gs.journalPending, JR_COUNTERS, &c, sizeof(c));
+	SaveJob job;
+	job.syncJournal = fsyncPolicy == FSYNC_ALWAYS;
+	swap(job.journalData, gs.journalPending);
+	journalBytes += (long long)job.journalData.size();
+	return submitSaveJob(job);
+}
+
+bool writeSaveFile(GameSession &gs) {
+	bool earlierFailed = takeSaveWriteFailure();
+	if (earlierFailed) saveFailureUnreported = true;
+	// a failed append may have left a partial batch behind: start over from a snapshot
+	if (earlierFailed || saveMode == SAVE_FULL || gs.journalNeedsSnapshot || journalBytes == 0) return writeSnapshot(gs);
+	long long limit = snapshotBytes > JOURNAL_MIN_COMPACT_BYTES ? snapshotBytes : JOURNAL_MIN_COMPACT_BYTES;
+	if (journalBytes + (long long)gs.journalPending.size() > limit) return writeSnapshot(gs);
+	return appendJournal(gs);
+}
+
+// Saves silently every autosaveEveryMoves moves (called between commands).
+void maybeAutosave(GameSession &gs) {
+	if (autosaveEveryMoves <= 0 || gs.totalMoves - gs.autosaveMovesMark < autosaveEveryMoves) return;
+	gs.autosaveMovesMark = gs.totalMoves;
+	writeSaveFile(gs);
+}
+
+void saveProgress(GameSession &gs, ostream &out) {
+	reportSave(writeSaveFile(gs), out);
+}
+
+// Tells the player about a background write that failed since they last
+// heard; with a writer thread running, a save is only queued when reported.
+void reportSave(bool ok, ostream &out) {
+	if (saveFailureUnreported) {
+		out << "An earlier save could not be written to " << SAVE_BIN << ".\n";
+		saveFailureUnreported = false;
+	}
+	if (!ok) { out << "Failed to open save file for writing.\n"; return; }
+	out << "Saving to " << SAVE_BIN << "...\n";
+	if (saveWriterThread.joinable()) out << "✅ Progress queued for saving.\n";
+	else out << "✅ Progress saved successfully!\n";
+}
+
+// Waits for the queued saves and reports one that failed (leaving a game,
+// and at exit once the writer has stopped).
+void reportSaveFailure(ostream &out) {
+	flushSaves();
+	if (takeSaveWriteFailure()) saveFailureUnreported = true;
+	if (!saveFailureUnreported) return;
+	out << "A save could not be written to " << SAVE_BIN << "; progress since the last good save may be lost.\n";
+	saveFailureUnreported = false;
+}
+
+// Applies the complete batches of SAVE_JOURNAL on top of the snapshot just
+// read. Counters are only carried in the globals; the caller recounts rooms.
+void replaySaveJournal(GameSession &gs, uint32_t generation, unsigned char version) {
+	journalBytes = 0;
+	if (generation == 0) return;
+	size_t headerBytes = version >= 6 ? sizeof(SaveJournalHeader) : offsetof(SaveJournalHeader, reserved);
+	ifstream fin(SAVE_JOURNAL, ios::binary | ios::ate);
+	if (!fin) return;
+	streamoff fileSize = fin.tellg();
+	if (fileSize < (streamoff)headerBytes) return;
+	vector<char> buf((size_t)fileSize);
+	fin.seekg(0);
+	fin.read(buf.data(), fileSize);
+	if (fin.gcount() != fileSize) return;
+	SaveJournalHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(&h, buf.data(), headerBytes);
+	if (memcmp(h.magic, SAVE_JOURNAL_MAGIC, 4) != 0 || h.generation != generation || h.objectCount != totalObjects) return;
+	if (version >= 6 && h.itemsHash != itemDictionaryHash()) return;
+
+	// find the end of the last complete batch
+	size_t size = buf.size(), pos = headerBytes, committed = pos;
+	while (pos + 7 <= size) {
+		unsigned short len = 0;
+		memcpy(&len, &buf[pos + 1], 2);
+		if (pos + 3 + len + 4 > size) break;
+		uint32_t sum = 0;
+		memcpy(&sum, &buf[pos + 3 + len], 4);
+		if (sum != journalChecksum(&buf[pos], 3 + len)) break;
+		unsigned char type = (unsigned char)buf[pos];
+		pos += 3 + len + 4;
+		if (type == JR_COUNTERS) committed = pos;
+	}
+
+	for (pos = headerBytes; pos < committed; ) {
+		unsigned char type = (unsigned char)buf[pos];
+		unsigned short len = 0;
+		memcpy(&len, &buf[pos + 1], 2);
+		const char* payload = &buf[pos + 3];
+		int32_t v = 0;
+		if (len >= sizeof(v)) memcpy(&v, payload, sizeof(v));
+		if (type == JR_SOLVED && len == sizeof(v) && v >= 0 && v < totalObjects) {
+			gs.objectSolvedBits[v >> 5] |= 1u << (v & 31);
+		}
+		else if (type == JR_ITEM_ID && len == sizeof(v)) {
+			addInventory(gs, v);
+		}
+		else if (type == JR_ITEM_ADD && len > 0) {
+			addInventory(gs, findItemId(payload, len));
+		}
+		else if (type == JR_ITEM_REMOVE && len == sizeof(v)) {
+			removeInventoryAt(gs, v);
+		}
+		else if (type == JR_COUNTERS && len == sizeof(JournalCounters)) {
+			JournalCounters c;
+			memcpy(&c, payload, sizeof(c));
+			gs.difficultyLevel = c.difficulty;
+			gs.currentRoomIndex = c.roomIndex;
+			gs.totalMoves = c.moves;
+			gs.hintsUsed = c.hints;
+			gs.accumulatedElapsed = c.elapsed;
+		}
+		pos += 3 + len + 4;
+	}
+	journalBytes = (long long)committed;
+	// a torn tail must not end up in front of later batches
+	if (committed < size) gs.journalNeedsSnapshot = true;
+}
+
+bool loadProgress(GameSession &gs) {
+	flushSaves();
+	if (!fileExists(SAVE_BIN)) { cout << "No save file found.\n"; return false; }
+	ifstream fin(SAVE_BIN, ios::binary);
+	if (!fin) { cout << "Failed to open save file.\n"; return false; }
+	char magic[6]; memset(magic, 0, sizeof(magic));
+	fin.read(magic, 5);
+	if (fin.gcount() != 5 || strncmp(magic, "ESCP1", 5) != 0) { cout << "Invalid or corrupted save file.\n"; fin.close(); return false; }
+	unsigned char version = 0; fin.read((char*)&version, 1);
+	if (version < 1 || version > SAVE_VERSION) { cout << "Save file version " << (int)version << " is not supported.\n"; fin.close(); return false; }
+	uint32_t generation = 0;
+	if (version >= 3) fin.read((char*)&generation, sizeof(generation));
+	uint64_t layoutSeed = 0;
+	if (version >= 4) fin.read((char*)&layoutSeed, sizeof(layoutSeed));
+	unsigned char diff = 0; fin.read((char*)&diff, 1);
+	int cRoom = 0; fin.read((char*)&cRoom, sizeof(int));
+	int tMoves = 0; fin.read((char*)&tMoves, sizeof(int));
+	int hUsed = 0; fin.read((char*)&hUsed, sizeof(int));
+	int elapsed = 0; fin.read((char*)&elapsed, sizeof(int));
+	int fileItems = 0;
+	if (version >= 5) {
+		fin.read((char*)&fileItems, sizeof(int));
+		if (fileItems != totalItems) { cout << "Save file item count mismatch; cannot load.\n"; fin.close(); return false; }
+	}
+	if (version >= 6) {
+		uint64_t itemsHash = 0;
+		fin.read((char*)&itemsHash, sizeof(itemsHash));
+		if (itemsHash != itemDictionaryHash()) { cout << "Save file was made with a different item list; cannot load.\n"; fin.close(); return false; }
+	}
+	int inv = 0; fin.read((char*)&inv, sizeof(int));
+	if (inv < 0) inv = 0;
+	clearInventory(gs);
+	for (int i = 0; i < inv && fin; ++i) {
+		if (version >= 5) {
+			int id = -1; fin.read((char*)&id, sizeof(int));
+			addInventory(gs, id);
+			continue;
+		}
+		// older saves store names; ones no object gives any more are dropped
+		int len = 0; fin.read((char*)&len, sizeof(int));
+		if (len <= 0) continue;
+		string name((size_t)len, '\0');
+		fin.read(&name[0], len);
+		addInventory(gs, findItemId(name.data(), name.size()));
+	}
+	int fileTotalObjects = 0; fin.read((char*)&fileTotalObjects, sizeof(int));
+	if (fileTotalObjects != totalObjects) { cout << "Save file object count mismatch; cannot load.\n"; fin.close(); return false; }
+	if (version == 1) {
+		for (int i = 0; i < solvedWordCount(); ++i) gs.objectSolvedBits[i] = 0;
+		for (int i = 0; i < totalObjects; ++i) {
+			unsigned char f = 0; fin.read((char*)&f, 1);
+			if (f) gs.objectSolvedBits[i >> 5] |= 1u << (i & 31);
+		}
+	}
+	else {
+		fin.read((char*)gs.objectSolvedBits, solvedWordCount() * sizeof(unsigned int));
+		if (totalObjects % 32 != 0) gs.objectSolvedBits[totalObjects >> 5] &= (1u << (totalObjects % 32)) - 1;
+	}
+	snapshotBytes = (long long)fin.tellg();
+	fin.close();
+	// rebuild the saved puzzle layout; older saves predate shuffling being saved
+	if (version >= 4) randomizePuzzles(gs, layoutSeed);
+	else resetPuzzleLayout(gs);
+	gs.difficultyLevel = (int)diff;
+	gs.currentRoomIndex = cRoom;
+	gs.totalMoves = tMoves;
+	gs.hintsUsed = hUsed;
+	gs.accumulatedElapsed = elapsed;
+
+	// the loaded state is the on-disk state: nothing pending, later saves extend the journal
+	gs.journalPending.clear();
+	gs.journalNeedsSnapshot = false;
+	gs.journalRecording = false;
+	replaySaveJournal(gs, generation, version);
+	gs.journalRecording = true;
+	saveGeneration = generation;
+
+	recountUnsolved(gs);
+	gs.startTime = time(nullptr) - gs.accumulatedElapsed;
+	gs.autosaveMovesMark = gs.totalMoves;
+	cout << "Save loaded successfully. Resuming from room " << (gs.currentRoomIndex + 1) << ".\n";
+	return true;
+}
+
+// --save-mode=full|journal  --fsync=never|snapshot|always  --autosave=N  --seed=N  --record=FILE  --typos=on|off  --ansi  --watch
+bool parseGameOptions(int argc, char** argv) {
+	for (int i = 1; i < argc; ++i) {
+		const char* a = argv[i];
+		if (strncmp(a, "--save-mode=", 12) == 0) {
+			if (_stricmp(a + 12, "full") == 0) saveMode = SAVE_FULL;
+			else if (_stricmp(a + 12, "journal") == 0) saveMode = SAVE_JOURNALED;
+			else { cout << "Unknown save mode '" << (a + 12) << "' (use full or journal).\n"; return false; }
+		}
+		else if (strncmp(a, "--fsync=", 8) == 0) {
+			if (_stricmp(a + 8, "never") == 0) fsyncPolicy = FSYNC_NEVER;
+			else if (_stricmp(a + 8, "snapshot") == 0) fsyncPolicy = FSYNC_SNAPSHOT;
+			else if (_stricmp(a + 8, "always") == 0) fsyncPolicy = FSYNC_ALWAYS;
+			else { cout << "Unknown fsync policy '" << (a + 8) << "' (use never, snapshot or always).\n"; return false; }
+		}
+		else if (strncmp(a, "--autosave=", 11) == 0) {
+			autosaveEveryMoves = safeAtoi(a + 11);
+			if (autosaveEveryMoves < 0) autosaveEveryMoves = 0;
+		}
+		else if (strncmp(a, "--seed=", 7) == 0) {
+			gameSeedBase = strtoull(a + 7, nullptr, 10);
+		}
+		else if (strncmp(a, "--record=", 9) == 0) {
+			tracePath = a + 9;
+		}
+		else if (strcmp(a, "--ansi") == 0) {
+			ansiScreen = true;
+			enableAnsiScreen();
+		}
+		else if (strncmp(a, "--parse-threads=", 16) == 0) {
+			parseThreads = safeAtoi(a + 16);
+			if (parseThreads < 0) parseThreads = 0;
+		}
+		else if (strcmp(a, "--watch") == 0) {
+			watchCatalog = true;
+			hashRoomText = true;
+		}
+		else if (strncmp(a, "--typos=", 8) == 0) {
+			if (_stricmp(a + 8, "on") == 0) typoTolerance = true;
+			else if (_stricmp(a + 8, "off") == 0) typoTolerance = false;
+			else { cout << "Unknown typo setting '" << (a + 8) << "' (use on or off).\n"; return false; }
+		}
+	}
+	return true;
+}
+
+/* ========== High scores ========== */
+
+// highscores.dat: a 12-byte header followed by fixed-width records, so the
+// file can be mapped and scanned in place. Files written before the header
+// existed (length-prefixed names) are converted on first use.
+const char HS_MAGIC[4] = { 'E', 'R', 'H', 'S' };
+const uint32_t HS_VERSION = 2;
+const int HS_TOP_N = 20;
+
+struct HighScoreHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t recordSize;
+};
+
+struct HighScoreRecord {
+	char name[MAX_PLAYER_NAME]; // NUL-padded
+	int32_t score;
+	int32_t timeSec;
+	uint16_t hints;
+	uint8_t difficulty;
+	uint8_t reserved;
+};
+
+void fillHighScoreRecord(HighScoreRecord &rec, const char* name, int score, int timeSec, int diff, int hints) {
+	memset(&rec, 0, sizeof(rec));
+	size_t len = strlen(name);
+	if (len > (size_t)(MAX_PLAYER_NAME - 1)) len = MAX_PLAYER_NAME - 1;
+	memcpy(rec.name, name, len);
+	rec.score = score;
+	rec.timeSec = timeSec;
+	rec.hints = (uint16_t)hints;
+	rec.difficulty = (uint8_t)diff;
+}
+
+bool hasHighScoreHeader(const char* fname) {
+	ifstream fin(fname, ios::binary);
+	if (!fin) return false;
+	HighScoreHeader h;
+	fin.read((char*)&h, sizeof(h));
+	return fin.gcount() == (streamsize)sizeof(h) && memcmp(h.magic, HS_MAGIC, 4) == 0 && h.version == HS_VERSION && h.recordSize == sizeof(HighScoreRecord);
+}
+
+// Rewrites a legacy variable-length highscores.dat in the fixed-record format.
+bool convertLegacyHighScores() {
+	ifstream fin(HIGHSCORES_BIN, ios::binary);
+	if (!fin) return false;
+	vector<HighScoreRecord> recs;
+	while (fin.peek() != EOF) {
+		int nlen = 0;
+		fin.read((char*)&nlen, sizeof(int));
+		if (fin.eof() || nlen < 0 || nlen > 4096) break;
+		char nbuf[4097];
+		if (nlen > 0) fin.read(nbuf, nlen);
+		nbuf[nlen] = 0;
+		unsigned char d = 0; fin.read((char*)&d, 1);
+		int t = 0; fin.read((char*)&t, sizeof(int));
+		int sc = 0; fin.read((char*)&sc, sizeof(int));
+		unsigned short hs = 0; fin.read((char*)&hs, sizeof(unsigned short));
+		if (!fin) break;
+		HighScoreRecord rec;
+		fillHighScoreRecord(rec, nbuf, sc, t, d, hs);
+		recs.push_back(rec);
+	}
+	fin.close();
+
+	string tmp = string(HIGHSCORES_BIN) + ".tmp";
+	ofstream fout(tmp.c_str(), ios::binary | ios::trunc);
+	if (!fout) return false;
+	HighScoreHeader h;
+	memcpy(h.magic, HS_MAGIC, 4);
+	h.version = HS_VERSION;
+	h.recordSize = sizeof(HighScoreRecord);
+	fout.write((const char*)&h, sizeof(h));
+	if (!recs.empty()) fout.write((const char*)recs.data(), (streamsize)(recs.size() * sizeof(HighScoreRecord)));
+	fout.close();
+	if (fout.fail()) return false;
+	return replaceFile(tmp.c_str(), HIGHSCORES_BIN);
+}
+
+// Makes sure an existing highscores.dat is in the current format.
+bool ensureHighScoreFormat() {
+	if (!fileExists(HIGHSCORES_BIN) || hasHighScoreHeader(HIGHSCORES_BIN)) return true;
+	int64_t size = 0, mtime = 0;
+	if (statFile(HIGHSCORES_BIN, size, mtime) && size == 0) return true;
+	return convertLegacyHighScores();
+}
+
+// Heap order for the top-N selection: the "greatest" element is the worst
+// kept entry (lowest score, and among equal scores the later record).
+struct HighScoreRank {
+	int score;
+	size_t index;
+};
+
+bool highScoreRankBetter(const HighScoreRank &a, const HighScoreRank &b) {
+	if (a.score != b.score) return a.score > b.score;
+	return a.index < b.index;
+}
+
+/* ========== Segmented leaderboard store ========== */
+
+// Scores live in HIGHSCORES_DIR:
+//   seg-<pid>-<time>.dat  one append-only segment per game process
+//   index.dat             compacted index (top entries per difficulty plus
+//                         every player's best per difficulty)
+//   merge-<gen>-*.dat     segments being folded into index generation <gen>
+//   lock                  namespace lock: shared while opening/appending/
+//                         reading files, exclusive while renaming/deleting
+//   compact.lock          held by the single process that is compacting
+// All files use the fixed-record layout above; the index header also stores
+// its generation so leftovers of an interrupted compaction are recognized.
+const char* HIGHSCORES_DIR = "highscores.d";
+const char LB_INDEX_MAGIC[4] = { 'E', 'R', 'H', 'I' };
+const int LB_KEEP_PER_DIFFICULTY = 100;
+const int64_t LB_COMPACT_BYTES = 64 * 1024; // compact once segments hold this much
+const int LB_COMPACT_INTERVAL_SEC = 30;
+
+struct LeaderboardIndexHeader {
+	HighScoreHeader base;
+	uint64_t generation;
+};
+
+struct FileLock {
+#ifdef _WIN32
+	HANDLE h;
+#else
+	int fd;
+#endif
+};
+
+bool acquireFileLock(const string &path, bool exclusive, bool wait, FileLock &lk) {
+#ifdef _WIN32
+	lk.h = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (lk.h == INVALID_HANDLE_VALUE) return false;
+	OVERLAPPED ov;
+	memset(&ov, 0, sizeof(ov));
+	DWORD flags = (exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0) | (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY);
+	if (!LockFileEx(lk.h, flags, 0, 1, 0, &ov)) { CloseHandle(lk.h); lk.h = INVALID_HANDLE_VALUE; return false; }
+#else
+	lk.fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (lk.fd < 0) return false;
+	if (flock(lk.fd, (exclusive ? LOCK_EX : LOCK_SH) | (wait ? 0 : LOCK_NB)) != 0) { close(lk.fd); lk.fd = -1; return false; }
+#endif
+	return true;
+}
+
+void releaseFileLock(FileLock &lk) {
+#ifdef _WIN32
+	if (lk.h != INVALID_HANDLE_VALUE) {
+		OVERLAPPED ov;
+		memset(&ov, 0, sizeof(ov));
+		UnlockFileEx(lk.h, 0, 1, 0, &ov);
+		CloseHandle(lk.h);
+	}
+	lk.h = INVALID_HANDLE_VALUE;
+#else
+	if (lk.fd >= 0) { flock(lk.fd, LOCK_UN); close(lk.fd); }
+	lk.fd = -1;
+#endif
+}
+
+bool makeDirectory(const char* path) {
+#ifdef _WIN32
+	return CreateDirectoryA(path, NULL) != 0 || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+	return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+void listDirectory(const char* dir, vector<string> &names) {
+	names.clear();
+#ifdef _WIN32
+	WIN32_FIND_DATAA fd;
+	HANDLE h = FindFirstFileA((string(dir) + "\\*").c_str(), &fd);
+	if (h == INVALID_HANDLE_VALUE) return;
+	do {
+		if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) names.push_back(fd.cFileName);
+	} while (FindNextFileA(h, &fd));
+	FindClose(h);
+#else
+	DIR* d = opendir(dir);
+	if (!d) return;
+	struct dirent* e;
+	while ((e = readdir(d)) != nullptr) {
+		if (e->d_name[0] != '.') names.push_back(e->d_name);
+	}
+	closedir(d);
+#endif
+}
+
+int currentProcessId() {
+#ifdef _WIN32
+	return (int)GetCurrentProcessId();
+#else
+	return (int)getpid();
+#endif
+}
+
+string leaderboardPath(const string &name) {
+	return string(HIGHSCORES_DIR) + "/" + name;
+}
+
+bool startsWith(const string &s, const char* prefix) {
+	return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// This process's segment; the name is fixed for the life of the process.
+const string &ownSegmentName() {
+	static string name = "seg-" + to_string(currentProcessId()) + "-" + to_string((long long)time(nullptr)) + ".dat";
+	return name;
+}
+
+void writeHighScoreHeader(ofstream &fout) {
+	HighScoreHeader h;
+	memcpy(h.magic, HS_MAGIC, 4);
+	h.version = HS_VERSION;
+	h.recordSize = sizeof(HighScoreRecord);
+	fout.write((const char*)&h, sizeof(h));
+}
+
+// Reads the index generation (0 when there is no index yet).
+uint64_t readIndexGeneration() {
+	ifstream fin(leaderboardPath("index.dat").c_str(), ios::binary);
+	if (!fin) return 0;
+	LeaderboardIndexHeader ih;
+	fin.read((char*)&ih, sizeof(ih));
+	if (fin.gcount() != (streamsize)sizeof(ih) || memcmp(ih.base.magic, LB_INDEX_MAGIC, 4) != 0) return 0;
+	return ih.generation;
+}
+
+// "merge-<gen>-..." -> gen
+uint64_t mergeGeneration(const string &name) {
+	return (uint64_t)strtoull(name.c_str() + 6, nullptr, 10);
+}
+
+// Moves a pre-segment highscores.dat into the store as an ordinary segment.
+bool importLegacyHighScores() {
+	if (!makeDirectory(HIGHSCORES_DIR)) return false;
+	if (!fileExists(HIGHSCORES_BIN)) return true;
+	if (!ensureHighScoreFormat()) return false;
+	FileLock lk;
+	if (!acquireFileLock(leaderboardPath("lock"), true, true, lk)) return false;
+	string dst = leaderboardPath("seg-import-" + to_string(currentProcessId()) + "-" + to_string((long long)time(nullptr)) + ".dat");
+	bool ok = !fileExists(HIGHSCORES_BIN) || rename(HIGHSCORES_BIN, dst.c_str()) == 0;
+	releaseFileLock(lk);
+	return ok;
+}
+
+void requestLeaderboardCompaction();
+
+mutex leaderboardAppendMutex;
+
+void appendHighScore(const char* name, int score, int timeSec, int diff, int hints, ostream &out) {
+	if (!importLegacyHighScores()) { out << "Unable to open high score store.\n"; return; }
+	HighScoreRecord rec;
+	fillHighScoreRecord(rec, name, score, timeSec, diff, hints);
+	bool ok = false;
+	{
+		lock_guard<mutex> guard(leaderboardAppendMutex);
+		FileLock lk;
+		if (acquireFileLock(leaderboardPath("lock"), false, true, lk)) {
+			string seg = leaderboardPath(ownSegmentName());
+			int64_t size = 0, mtime = 0;
+			bool fresh = !statFile(seg.c_str(), size, mtime) || size == 0;
+			ofstream fout(seg.c_str(), ios::binary | ios::app);
+			if (fout) {
+				if (fresh) writeHighScoreHeader(fout);
+				fout.write((const char*)&rec, sizeof(rec));
+				fout.close();
+				ok = !fout.fail();
+			}
+			releaseFileLock(lk);
+		}
+	}
+	if (!ok) { out << "Unable to open high score file for writing.\n"; return; }
+	out << "High score recorded.\n";
+	requestLeaderboardCompaction();
+}
+
+// Total bytes sitting in live segments.
+int64_t leaderboardSegmentBytes() {
+	vector<string> names;
+	listDirectory(HIGHSCORES_DIR, names);
+	int64_t total = 0;
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (!startsWith(names[i], "seg-")) continue;
+		int64_t size = 0, mtime = 0;
+		if (statFile(leaderboardPath(names[i]).c_str(), size, mtime)) total += size;
+	}
+	return total;
+}
+
+// Size of the header of a mapped segment/index file, or 0 if it isn't one
+// (or holds records of another layout).
+size_t highScoreFileHeaderSize(const MappedFile &mf) {
+	size_t headerSize = 0;
+	if (mf.size >= sizeof(LeaderboardIndexHeader) && memcmp(mf.data, LB_INDEX_MAGIC, 4) == 0) headerSize = sizeof(LeaderboardIndexHeader);
+	else if (mf.size >= sizeof(HighScoreHeader) && memcmp(mf.data, HS_MAGIC, 4) == 0) headerSize = sizeof(HighScoreHeader);
+	if (headerSize == 0) return 0;
+	HighScoreHeader h;
+	memcpy(&h, mf.data, sizeof(h));
+	return h.version == HS_VERSION && h.recordSize == sizeof(HighScoreRecord) ? headerSize : 0;
+}
+
+// Appends the records of a segment/index file to 'out'.
+void readHighScoreRecords(const string &path, vector<HighScoreRecord> &out) {
+	MappedFile mf;
+	if (!mapFileReadOnly(path.c_str(), mf)) return;
+	size_t headerSize = highScoreFileHeaderSize(mf);
+	if (headerSize > 0) {
+		size_t cnt = (mf.size - headerSize) / sizeof(HighScoreRecord);
+		const HighScoreRecord* recs = (const HighScoreRecord*)(mf.data + headerSize);
+		out.insert(out.end(), recs, recs + cnt);
+	}
+	unmapFile(mf);
+}
+
+// Folds all live segments into a new index generation. Only one process
+// compacts at a time; returns false if another one is already at it.
+bool compactLeaderboard() {
+	if (!makeDirectory(HIGHSCORES_DIR)) return false;
+	FileLock compactLock;
+	if (!acquireFileLock(leaderboardPath("compact.lock"), true, false, compactLock)) return false;
+
+	uint64_t gen = readIndexGeneration();
+	uint64_t newGen = gen + 1;
+	vector<string> names;
+
+	// claim the current segments (and drop leftovers that are already indexed)
+	FileLock lk;
+	if (!acquireFileLock(leaderboardPath("lock"), true, true, lk)) { releaseFileLock(compactLock); return false; }
+	listDirectory(HIGHSCORES_DIR, names);
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (startsWith(names[i], "seg-")) {
+			string dst = "merge-" + to_string((unsigned long long)newGen) + "-" + names[i];
+			rename(leaderboardPath(names[i]).c_str(), leaderboardPath(dst).c_str());
+		}
+		else if (startsWith(names[i], "merge-") && mergeGeneration(names[i]) <= gen) {
+			remove(leaderboardPath(names[i]).c_str());
+		}
+	}
+	releaseFileLock(lk);
+
+	// index first, so equal scores keep their original order
+	vector<HighScoreRecord> all;
+	vector<string> inputs;
+	readHighScoreRecords(leaderboardPath("index.dat"), all);
+	listDirectory(HIGHSCORES_DIR, names);
+	sort(names.begin(), names.end());
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (startsWith(names[i], "merge-") && mergeGeneration(names[i]) > gen) {
+			readHighScoreRecords(leaderboardPath(names[i]), all);
+			inputs.push_back(names[i]);
+		}
+	}
+
+	// keep the top entries per difficulty plus each player's best per difficulty
+	vector<char> keep(all.size(), 0);
+	for (int d = 1; d <= 3; ++d) {
+		vector<HighScoreRank> ranks;
+		for (size_t i = 0; i < all.size(); ++i) {
+			if (all[i].difficulty != d) continue;
+			HighScoreRank e = { all[i].score, i };
+			ranks.push_back(e);
+		}
+		size_t n = ranks.size() < (size_t)LB_KEEP_PER_DIFFICULTY ? ranks.size() : (size_t)LB_KEEP_PER_DIFFICULTY;
+		partial_sort(ranks.begin(), ranks.begin() + n, ranks.end(), highScoreRankBetter);
+		for (size_t i = 0; i < n; ++i) keep[ranks[i].index] = 1;
+	}
+	unordered_map<string, size_t> best;
+	for (size_t i = 0; i < all.size(); ++i) {
+		string key = string(all[i].name, strnlen(all[i].name, MAX_PLAYER_NAME)) + '\n' + (char)('0' + all[i].difficulty);
+		unordered_map<string, size_t>::iterator it = best.find(key);
+		if (it == best.end()) best[key] = i;
+		else if (all[i].score > all[it->second].score) it->second = i;
+	}
+	for (unordered_map<string, size_t>::iterator it = best.begin(); it != best.end(); ++it) keep[it->second] = 1;
+
+	string tmp = leaderboardPath("index.tmp");
+	ofstream fout(tmp.c_str(), ios::binary | ios::trunc);
+	bool ok = (bool)fout;
+	if (ok) {
+		LeaderboardIndexHeader ih;
+		memset(&ih, 0, sizeof(ih));
+		memcpy(ih.base.magic, LB_INDEX_MAGIC, 4);
+		ih.base.version = HS_VERSION;
+		ih.base.recordSize = sizeof(HighScoreRecord);
+		ih.generation = newGen;
+		fout.write((const char*)&ih, sizeof(ih));
+		for (size_t i = 0; i < all.size(); ++i) if (keep[i]) fout.write((const char*)&all[i], sizeof(HighScoreRecord));
+		fout.close();
+		ok = !fout.fail();
+	}
+
+	// publish the index and drop the merged segments
+	if (ok && acquireFileLock(leaderboardPath("lock"), true, true, lk)) {
+		ok = replaceFile(tmp.c_str(), leaderboardPath("index.dat").c_str());
+		if (ok) for (size_t i = 0; i < inputs.size(); ++i) remove(leaderboardPath(inputs[i]).c_str());
+		releaseFileLock(lk);
+	}
+	releaseFileLock(compactLock);
+	return ok;
+}
+
+// Background compaction: wakes up periodically or after an append and folds
+// the segments into the index once they have grown past LB_COMPACT_BYTES.
+mutex compactorMutex;
+condition_variable compactorCv;
+bool compactorStop = false;
+bool compactorKick = false;
+thread compactorThread;
+
+void leaderboardCompactorMain() {
+	unique_lock<mutex> lk(compactorMutex);
+	while (!compactorStop) {
+		if (!compactorKick) compactorCv.wait_for(lk, chrono::seconds(LB_COMPACT_INTERVAL_SEC));
+		if (compactorStop) break;
+		compactorKick = false;
+		lk.unlock();
+		if (leaderboardSegmentBytes() >= LB_COMPACT_BYTES) compactLeaderboard();
+		lk.lock();
+	}
+}
+
+void startLeaderboardCompactor() {
+	importLegacyHighScores();
+	compactorStop = false;
+	compactorThread = thread(leaderboardCompactorMain);
+}
+
+void stopLeaderboardCompactor() {
+	if (!compactorThread.joinable()) return;
+	{
+		lock_guard<mutex> lk(compactorMutex);
+		compactorStop = true;
+	}
+	compactorCv.notify_all();
+	compactorThread.join();
+}
+
+void requestLeaderboardCompaction() {
+	{
+		lock_guard<mutex> lk(compactorMutex);
+		compactorKick = true;
+	}
+	compactorCv.notify_all();
+}
+
+struct TopScoreEntry {
+	HighScoreRank rank;
+	HighScoreRecord rec;
+};
+
+bool topScoreEntryBetter(const TopScoreEntry &a, const TopScoreEntry &b) {
+	return highScoreRankBetter(a.rank, b.rank);
+}
+
+// Scans one mapped file in place, feeding matching records through the
+// bounded top-N heap; 'seq' numbers records across files to keep ties stable.
+void collectTopScores(const string &path, int difficultyFilter, size_t &seq, vector<TopScoreEntry> &top) {
+	MappedFile mf;
+	if (!mapFileReadOnly(path.c_str(), mf)) return;
+	size_t headerSize = highScoreFileHeaderSize(mf);
+	size_t cnt = headerSize > 0 ? (mf.size - headerSize) / sizeof(HighScoreRecord) : 0;
+	const HighScoreRecord* recs = (const HighScoreRecord*)(mf.data + headerSize);
+	for (size_t i = 0; i < cnt; ++i, ++seq) {
+		if (difficultyFilter != 0 && recs[i].difficulty != difficultyFilter) continue;
+		TopScoreEntry e;
+		e.rank.score = recs[i].score;
+		e.rank.index = seq;
+		if ((int)top.size() < HS_TOP_N) {
+			e.rec = recs[i];
+			top.push_back(e);
+			push_heap(top.begin(), top.end(), topScoreEntryBetter);
+		}
+		else if (highScoreRankBetter(e.rank, top.front().rank)) {
+			e.rec = recs[i];
+			pop_heap(top.begin(), top.end(), topScoreEntryBetter);
+			top.back() = e;
+			push_heap(top.begin(), top.end(), topScoreEntryBetter);
+		}
+	}
+	unmapFile(mf);
+}
+
+// Reads only the compacted index plus whatever segments have not been folded
+// into it yet, keeping the best HS_TOP_N for the difficulty filter (0 = all).
+void showHighScores(int difficultyFilter, ostream &out) {
+	if (!importLegacyHighScores()) { out << "Unable to open high score store.\n"; return; }
+	vector<TopScoreEntry> top;
+	top.reserve(HS_TOP_N + 1);
+	FileLock lk;
+	if (!acquireFileLock(leaderboardPath("lock"), false, true, lk)) { out << "Unable to open high score store.\n"; return; }
+	uint64_t gen = readIndexGeneration();
+	vector<string> names;
+	listDirectory(HIGHSCORES_DIR, names);
+	sort(names.begin(), names.end());
+	size_t seq = 0;
+	collectTopScores(leaderboardPath("index.dat"), difficultyFilter, seq, top);
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (startsWith(names[i], "merge-") && mergeGeneration(names[i]) > gen) collectTopScores(leaderboardPath(names[i]), difficultyFilter, seq, top);
+	}
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (startsWith(names[i], "seg-")) collectTopScores(leaderboardPath(names[i]), difficultyFilter, seq, top);
+	}
+	releaseFileLock(lk);
+	sort_heap(top.begin(), top.end(), topScoreEntryBetter);
+	if (top.empty()) { out << "No high scores yet.\n"; return; }
+
+	out << "===== HIGH SCORES =====\n";
+	out << "# | Player                | Difficulty | Time   | Score | Hints\n";
+	out << "---------------------------------------------------------------\n";
+	for (size_t i = 0; i < top.size(); ++i) {
+		const HighScoreRecord &rec = top[i].rec;
+		char name[MAX_PLAYER_NAME + 1];
+		memcpy(name, rec.name, MAX_PLAYER_NAME);
+		name[MAX_PLAYER_NAME] = '\0';
+		string dstr = (rec.difficulty == 1 ? "Easy" : (rec.difficulty == 2 ? "Medium" : "Hard"));
+		int mm = rec.timeSec / 60; int ss = rec.timeSec % 60;
+		char timestr[16]; sprintf_s(timestr, "%02d:%02d", mm, ss);
+		out << setw(2) << (i + 1) << " | " << left << setw(21) << name << " | " << setw(9) << dstr << " | " << timestr << " | " << setw(5) << rec.score << " | " << setw(5) << rec.hints << "\n";
+	}
+}
+
+/* ========== Achievements & Summary helpers ========== */
+
+// Distinct items held, one popcount per 32 item ids.
+int countHeldItems(GameSession &gs) {
+	int c = 0;
+	for (int i = 0; i < itemWordCount(); ++i) c += popcount(gs.itemHeldBits[i]);
+	return c;
+}
+
+void captureLastGameSummary(GameSession &gs, int roomsExplored) {
+	// free previous snapshot
+	if (gs.lastItemsCollected) { delete[] gs.lastItemsCollected; gs.lastItemsCollected = nullptr; }
+	gs.lastItemsCount = 0;
+	if (gs.lastAchievements) {
+		for (int i = 0; i < gs.lastAchievementsCount; ++i) delete[] gs.lastAchievements[i];
+		delete[] gs.lastAchievements; gs.lastAchievements = nullptr;
+	}
+	gs.lastAchievementsCount = 0;
+
+	gs.lastSummaryAvailable = true;
+	gs.lastRoomsExplored = roomsExplored;
+	gs.lastTotalMoves = gs.totalMoves;
+	gs.lastElapsedSec = gs.accumulatedElapsed + (int)difftime(time(nullptr), gs.startTime);
+	gs.lastHintsUsed = gs.hintsUsed;
+	gs.lastDifficulty = gs.difficultyLevel;
+	gs.lastFinalScore = computeScore(gs);
+
+	// copy items
+	if (gs.invCount > 0) {
+		gs.lastItemsCollected = new(nothrow) int[gs.invCount];
+		if (!gs.lastItemsCollected) { cerr << "Memory alloc failed\n"; exit(1); }
+		for (int i = 0; i < gs.invCount; ++i) gs.lastItemsCollected[i] = gs.inventory[i];
+		gs.lastItemsCount = gs.invCount;
+	}
+	else {
+		gs.lastItemsCollected = nullptr; gs.lastItemsCount = 0;
+	}
+
+	// achievements
+	int achCap = 8;
+	gs.lastAchievements = new(nothrow) char*[achCap];
+	gs.lastAchievementsCount = 0;
+	if (!gs.lastAchievements) { cerr << "Memory alloc failed\n"; exit(1); }
+
+	// Master Detective: no hints used
+	if (gs.lastHintsUsed == 0) {
+		gs.lastAchievements[gs.lastAchievementsCount++] = allocCstrFromStd(string("Master Detective (No hints used)"));
+	}
+	// Speedrunner: under 5 minutes (300 sec)
+	if (gs.lastElapsedSec <= 300) gs.lastAchievements[gs.lastAchievementsCount++] = allocCstrFromStd(string("Speedrunner (Under 05:00)"));
+	// Collector: holds every item the rooms give
+	if (totalItems > 0 && countHeldItems(gs) == totalItems) gs.lastAchievements[gs.lastAchievementsCount++] = allocCstrFromStd(string("Collector (All items collected)"));
+	// Perfectionist: score 100/100
+	if (gs.lastFinalScore >= 100) gs.lastAchievements[gs.lastAchievementsCount++] = allocCstrFromStd(string("Perfectionist (Perfect score)"));
+	// If none, store "None"
+	if (gs.lastAchievementsCount == 0) gs.lastAchievements[gs.lastAchievementsCount++] = allocCstrFromStd(string("None"));
+
+	// resize array to actual count (not necessary but okay)
+}
+
+/* ========== Final summary display ========== */
+
+void formatTime(int sec, char* out, int outSize) {
+	int mm = sec / 60;
+	int ss = sec % 60;
+	sprintf_s(out, outSize, "%02d:%02d", mm, ss);
+}
+
+void showLastGameSummary(GameSession &gs, ostream &out) {
+	if (!gs.lastSummaryAvailable) { out << "No last-game summary available.\n"; return; }
+	clearScreen();
+	out << "===================== GAME SUMMARY =====================\n";
+	out << "Total rooms explored : " << gs.lastRoomsExplored << "\n";
+	out << "Total moves : " << gs.lastTotalMoves << "\n";
+	char timestr[32]; formatTime(gs.lastElapsedSec, timestr, sizeof(timestr));
+	out << "Time taken : " << timestr << "\n";
+	out << "Hints used : " << gs.lastHintsUsed << "\n";
+	out << "Items collected : ";
+	if (gs.lastItemsCount == 0) out << "None\n";
+	else {
+		for (int i = 0; i < gs.lastItemsCount; ++i) {
+			out << itemNames[gs.lastItemsCollected[i]];
+			if (i + 1 < gs.lastItemsCount) out << ", ";
+		}
+		out << "\n";
+	}
+	string dstr = (gs.lastDifficulty == 1 ? "Easy" : (gs.lastDifficulty == 2 ? "Medium" : "Hard"));
+	out << "Difficulty : " << dstr << "\n";
+	out << "Final Score : " << gs.lastFinalScore << "/100\n";
+	out << "--------------------------------------------------------\n";
+	out << "Achievements Unlocked:\n";
+	for (int i = 0; i < gs.lastAchievementsCount; ++i) {
+		out << "- " << gs.lastAchievements[i] << "\n";
+	}
+	out << "--------------------------------------------------------\n";
+}
+
+/* ========== Monte Carlo session simulator ========== */
+
+// Batch mode for balancing: runs bot sessions over the loaded catalog on a
+// work-stealing pool and reports score/move/hint distributions per difficulty
+// and strategy, plus per-room averages. Bots play through the engine on a
+// GameSession of their worker's own, so they follow the same rules as
+// players, and never touch the console while running.
+enum SimStrategy { SIM_RANDOM, SIM_HINT_HEAVY, SIM_OPTIMAL, SIM_STRATEGY_COUNT };
+const char* SIM_STRATEGY_NAMES[SIM_STRATEGY_COUNT] = { "Random", "Hint-heavy", "Optimal" };
+const int SIM_DIFFICULTIES = 3;
+const int SIM_CHUNK = 2048;          // sessions per task
+const int SIM_MOVE_BUCKETS = 1024;   // last bucket collects overflow
+const int SIM_HINT_BUCKETS = 256;
+const int SIM_RANDOM_HINT_AFTER = 5; // random guesser asks for a hint after this many misses
+
+struct SimTask {
+	int strategy;
+	int difficulty;
+	long long chunkId;
+	int count;
+};
+
+// Score, move and hint figures cover completed sessions only; a session
+// that got stuck is counted with how far it got.
+struct SimGroupStats {
+	long long sessions;
+	long long completed;
+	long long scoreSum, movesSum, hintsSum;
+	vector<long long> scoreHist; // 0..100
+	vector<long long> movesHist;
+	vector<long long> hintsHist;
+	long long stuckRoomsSum, stuckMovesSum;
+};
+
+struct SimRoomStats {
+	long long reached;
+	long long moves;
+	long long hints;
+	long long seconds;
+};
+
+struct SimWorker {
+	Rng rng;
+	GameSession gs;
+	vector<unsigned char> hinted;
+	vector<unsigned char> misses;
+	SimGroupStats groups[SIM_DIFFICULTIES][SIM_STRATEGY_COUNT];
+	vector<SimRoomStats> rooms[SIM_STRATEGY_COUNT];
+};
+
+struct SimQueue {
+	mutex m;
+	deque<SimTask> tasks;
+};
+
+vector<int> simTextAnswers; // objects with text answers: the random guesser's vocabulary
+
+void simInitGroup(SimGroupStats &g) {
+	g.sessions = 0; g.completed = 0;
+	g.scoreSum = 0; g.movesSum = 0; g.hintsSum = 0;
+	g.scoreHist.assign(101, 0);
+	g.movesHist.assign(SIM_MOVE_BUCKETS, 0);
+	g.hintsHist.assign(SIM_HINT_BUCKETS, 0);
+	g.stuckRoomsSum = 0; g.stuckMovesSum = 0;
+}
+
+void simInitWorker(SimWorker &w) {
+	if (!allocSession(w.gs)) exit(1);
+	int maxRoomObjects = 1;
+	for (int r = 0; r < totalRooms; ++r) if (roomObjectCount[r] > maxRoomObjects) maxRoomObjects = roomObjectCount[r];
+	w.hinted.assign(maxRoomObjects, 0);
+	w.misses.assign(maxRoomObjects, 0);
+	for (int d = 0; d < SIM_DIFFICULTIES; ++d)
+		for (int s = 0; s < SIM_STRATEGY_COUNT; ++s) simInitGroup(w.groups[d][s]);
+	SimRoomStats zero = { 0, 0, 0, 0 };
+	for (int s = 0; s < SIM_STRATEGY_COUNT; ++s) w.rooms[s].assign(totalRooms, zero);
+}
+
+// Builds the bot's answer for a puzzle (catalog object 'pos') into 'out'.
+void simGuess(SimWorker &w, int strategy, int pos, bool hinted, string &out) {
+	bool knows = strategy == SIM_OPTIMAL
+		|| (strategy == SIM_HINT_HEAVY && rngRange(w.rng, 1, 100) <= 80)
+		|| (strategy == SIM_RANDOM && hinted && answerMatchers[pos].type != PT_NUMBER && rngRange(w.rng, 1, 100) <= 30);
+	if (knows) { out = answerSample(pos); return; }
+	char buf[32];
+	int type = answerMatchers[pos].type;
+	if (type == PT_NUMBER || type == PT_RANGE) {
+		int v = safeAtoi(answerSample(pos));
+		int g = hinted ? rngRange(w.rng, v / 2, v + 5) : rngRange(w.rng, 0, 199);
+		sprintf_s(buf, sizeof(buf), "%d", g);
+		out = buf;
+	}
+	else if (!simTextAnswers.empty()) {
+		out = answerSample(simTextAnswers[rngRange(w.rng, 0, (int)simTextAnswers.size() - 1)]);
+	}
+	else out = "?";
+}
+
+int findUsableItem(GameSession &gs, int pos);
+
+// Whether a bot can get anywhere with unsolved object 'pos' yet: it has a
+// puzzle, hands over its item on inspection or an item held unlocks it.
+bool simObjectOpen(GameSession &gs, int pos) {
+	return objectHasPuzzle[pos] || puzzleGivesItem(gs, pos) || findUsableItem(gs, pos) >= 0;
+}
+
+// Room-local object the bot works on next, -1 when none in the room is open.
+// The random guesser picks any object, solved or not, while one is open.
+int simPickObject(SimWorker &w, int strategy, int r) {
+	GameSession &gs = w.gs;
+	int start = roomObjectStart[r];
+	int cnt = roomObjectCount[r];
+	int first = -1;
+	for (int i = 0; i < cnt && first < 0; ++i) if (!isObjectSolved(gs, start + i) && simObjectOpen(gs, start + i)) first = i;
+	if (first < 0 || strategy != SIM_RANDOM) return first;
+	return rngRange(w.rng, 0, cnt - 1);
+}
+
+// Plays one game through the engine the way the console does: every attempt
+// inspects an object (a move), then uses an item that unlocks it or asks for
+// a hint and/or answers its puzzle. Time is simulated. The game is abandoned when no object in the
+// room can be opened or the room takes too many moves.
+void simulateSession(SimWorker &w, int strategy, int difficulty) {
+	GameSession &gs = w.gs;
+	engineNewGame(gs, difficulty, rngNext(w.rng));
+	int elapsed = 0, roomsCleared = 0;
+	bool stuck = false;
+	string guess;
+	EngineCommand cmd;
+	EngineResult res;
+	for (int r = 0; r < totalRooms && !stuck; ++r) {
+		gs.currentRoomIndex = r;
+		int start = roomObjectStart[r];
+		int cnt = roomObjectCount[r];
+		int roomMoves = gs.totalMoves, roomHints = gs.hintsUsed, roomSecs = 0;
+		int cap = 50 + 20 * cnt;
+		for (int i = 0; i < cnt; ++i) { w.hinted[i] = 0; w.misses[i] = 0; }
+		while (!isRoomCompleted(gs, r)) {
+			int local = simPickObject(w, strategy, r);
+			if (local < 0 || gs.totalMoves - roomMoves >= cap) { stuck = true; break; }
+			int pos = start + local;
+			roomSecs += rngRange(w.rng, 3, 15);
+			cmd.type = CMD_INSPECT;
+			cmd.object = local;
+			cmd.item = -1;
+			cmd.text = nullptr;
+			engineApply(gs, cmd, res);
+			if (res.status == ENGINE_NO_PUZZLE && !isObjectSolved(gs, pos)) {
+				cmd.item = findUsableItem(gs, pos);
+				if (cmd.item < 0) continue;
+				cmd.type = CMD_USE_ITEM;
+				engineApply(gs, cmd, res);
+				continue;
+			}
+			if (res.status != ENGINE_PUZZLE) continue;
+			bool wantHint = (strategy == SIM_HINT_HEAVY && !w.hinted[local])
+				|| (strategy == SIM_RANDOM && !w.hinted[local] && w.misses[local] >= SIM_RANDOM_HINT_AFTER);
+			if (wantHint) {
+				w.hinted[local] = 1;
+				cmd.type = CMD_HINT;
+				engineApply(gs, cmd, res);
+				roomSecs += 5;
+			}
+			simGuess(w, strategy, gs.puzzleSource[pos], w.hinted[local] != 0, guess);
+			cmd.type = CMD_ANSWER;
+			cmd.text = guess.c_str();
+			engineApply(gs, cmd, res);
+			if (res.status == ENGINE_WRONG_ANSWER && w.misses[local] < 255) ++w.misses[local];
+		}
+		SimRoomStats &rs = w.rooms[strategy][r];
+		++rs.reached;
+		rs.moves += gs.totalMoves - roomMoves;
+		rs.hints += gs.hintsUsed - roomHints;
+		rs.seconds += roomSecs;
+		elapsed += roomSecs;
+		if (!stuck) ++roomsCleared;
+	}
+	SimGroupStats &g = w.groups[difficulty - 1][strategy];
+	++g.sessions;
+	if (stuck) {
+		g.stuckRoomsSum += roomsCleared;
+		g.stuckMovesSum += gs.totalMoves;
+		return;
+	}
+	int moves = gs.totalMoves, hints = gs.hintsUsed;
+	int score = scoreFor(elapsed, hints, moves, difficulty);
+	++g.completed;
+	g.scoreSum += score;
+	g.movesSum += moves;
+	g.hintsSum += hints;
+	++g.scoreHist[score];
+	++g.movesHist[moves < SIM_MOVE_BUCKETS ? moves : SIM_MOVE_BUCKETS - 1];
+	++g.hintsHist[hints < SIM_HINT_BUCKETS ? hints : SIM_HINT_BUCKETS - 1];
+}
+
+// Pops from the back of the worker's own queue, otherwise steals from the
+// front of another worker's queue.
+bool simTakeTask(vector<SimQueue*> &queues, int self, SimTask &task) {
+	{
+		lock_guard<mutex> lk(queues[self]->m);
+		if (!queues[self]->tasks.empty()) {
+			task = queues[self]->tasks.back();
+			queues[self]->tasks.pop_back();
+			return true;
+		}
+	}
+	int n = (int)queues.size();
+	for (int k = 1; k < n; ++k) {
+		SimQueue* victim = queues[(self + k) % n];
+		lock_guard<mutex> lk(victim->m);
+		if (!victim->tasks.empty()) {
+			task = victim->tasks.front();
+			victim->tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void simWorkerMain(vector<SimQueue*> *queues, int self, SimWorker *w, uint64_t seed, Catalog* catalog) {
+	bindCatalog(catalog);
+	SimTask task;
+	while (simTakeTask(*queues, self, task)) {
+		// reseeded per task, so results don't depend on which worker ran which task
+		rngSeed(w->rng, seed ^ splitMix64((uint64_t)task.chunkId));
+		for (int i = 0; i < task.count; ++i) simulateSession(*w, task.strategy, task.difficulty);
+	}
+}
+
+int simPercentile(const vector<long long> &hist, long long total, double q) {
+	if (total <= 0) return 0;
+	long long target = (long long)(q * (double)(total - 1));
+	long long seen = 0;
+	for (size_t i = 0; i < hist.size(); ++i) {
+		seen += hist[i];
+		if (seen > target) return (int)i;
+	}
+	return (int)hist.size() - 1;
+}
+
+void simMergeGroup(SimGroupStats &into, const SimGroupStats &from) {
+	into.sessions += from.sessions;
+	into.completed += from.completed;
+	into.scoreSum += from.scoreSum;
+	into.movesSum += from.movesSum;
+	into.hintsSum += from.hintsSum;
+	into.stuckRoomsSum += from.stuckRoomsSum;
+	into.stuckMovesSum += from.stuckMovesSum;
+	for (size_t i = 0; i < into.scoreHist.size(); ++i) into.scoreHist[i] += from.scoreHist[i];
+	for (size_t i = 0; i < into.movesHist.size(); ++i) into.movesHist[i] += from.movesHist[i];
+	for (size_t i = 0; i < into.hintsHist.size(); ++i) into.hintsHist[i] += from.hintsHist[i];
+}
+
+void runSimulation(long long sessionsPerGroup, int threads, uint64_t seed) {
+	if (threads < 1) threads = 1;
+	simTextAnswers.clear();
+	for (int i = 0; i < totalObjects; ++i) {
+		int type = answerMatchers[i].type;
+		if (type != PT_NONE && type != PT_NUMBER && type != PT_RANGE) simTextAnswers.push_back(i);
+	}
+
+	// tasks are dealt round-robin; idle workers steal the rest
+	vector<SimQueue*> queues;
+	for (int t = 0; t < threads; ++t) queues.push_back(new SimQueue());
+	long long chunkId = 0;
+	int next = 0;
+	for (int d = 1; d <= SIM_DIFFICULTIES; ++d) {
+		for (int s = 0; s < SIM_STRATEGY_COUNT; ++s) {
+			for (long long done = 0; done < sessionsPerGroup; done += SIM_CHUNK) {
+				SimTask task;
+				task.strategy = s;
+				task.difficulty = d;
+				task.chunkId = chunkId++;
+				task.count = (int)(sessionsPerGroup - done < SIM_CHUNK ? sessionsPerGroup - done : SIM_CHUNK);
+				queues[next]->tasks.push_back(task);
+				next = (next + 1) % threads;
+			}
+		}
+	}
+
+	vector<SimWorker*> workers;
+	for (int t = 0; t < threads; ++t) {
+		workers.push_back(new SimWorker());
+		simInitWorker(*workers[t]);
+	}
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	vector<thread> pool;
+	for (int t = 0; t < threads; ++t) pool.push_back(thread(simWorkerMain, &queues, t, workers[t], seed, boundCatalog));
+	for (size_t t = 0; t < pool.size(); ++t) pool[t].join();
+	double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+	// merge per-worker results
+	SimWorker &total = *workers[0];
+	for (int t = 1; t < threads; ++t) {
+		for (int d = 0; d < SIM_DIFFICULTIES; ++d)
+			for (int s = 0; s < SIM_STRATEGY_COUNT; ++s) simMergeGroup(total.groups[d][s], workers[t]->groups[d][s]);
+		for (int s = 0; s < SIM_STRATEGY_COUNT; ++s)
+			for (int r = 0; r < totalRooms; ++r) {
+				total.rooms[s][r].reached += workers[t]->rooms[s][r].reached;
+				total.rooms[s][r].moves += workers[t]->rooms[s][r].moves;
+				total.rooms[s][r].hints += workers[t]->rooms[s][r].hints;
+				total.rooms[s][r].seconds += workers[t]->rooms[s][r].seconds;
+			}
+	}
+
+	long long all = sessionsPerGroup * SIM_DIFFICULTIES * SIM_STRATEGY_COUNT;
+	char line[256];
+	sprintf_s(line, sizeof(line), "Simulated %lld sessions on %d thread(s) in %.2f s (%.0f sessions/s).", all, threads, secs, secs > 0 ? all / secs : 0.0);
+	cout << line << "\n\n";
+	cout << "Difficulty | Strategy   | Done%  | Score mean  p10  p50  p90 | Moves mean  p50  p90 | Hints mean  p50  p90\n";
+	cout << "-------------------------------------------------------------------------------------------------------\n";
+	const char* dnames[SIM_DIFFICULTIES] = { "Easy", "Medium", "Hard" };
+	for (int d = 0; d < SIM_DIFFICULTIES; ++d) {
+		for (int s = 0; s < SIM_STRATEGY_COUNT; ++s) {
+			SimGroupStats &g = total.groups[d][s];
+			if (g.sessions == 0) continue;
+			double n = g.completed > 0 ? (double)g.completed : 1.0;
+			sprintf_s(line, sizeof(line), "%-10s | %-10s | %5.1f%% | %10.1f %4d %4d %4d | %10.1f %4d %4d | %10.2f %4d %4d",
+				dnames[d], SIM_STRATEGY_NAMES[s], 100.0 * g.completed / g.sessions,
+				g.scoreSum / n, simPercentile(g.scoreHist, g.completed, 0.1), simPercentile(g.scoreHist, g.completed, 0.5), simPercentile(g.scoreHist, g.completed, 0.9),
+				g.movesSum / n, simPercentile(g.movesHist, g.completed, 0.5), simPercentile(g.movesHist, g.completed, 0.9),
+				g.hintsSum / n, simPercentile(g.hintsHist, g.completed, 0.5), simPercentile(g.hintsHist, g.completed, 0.9));
+			cout << line << "\n";
+		}
+	}
+
+	// abandoned games, kept out of the figures above
+	cout << "\nDifficulty | Strategy   | Abandoned  | Rooms cleared mean | Moves mean\n";
+	cout << "----------------------------------------------------------------------\n";
+	for (int d = 0; d < SIM_DIFFICULTIES; ++d) {
+		for (int s = 0; s < SIM_STRATEGY_COUNT; ++s) {
+			SimGroupStats &g = total.groups[d][s];
+			long long stuck = g.sessions - g.completed;
+			if (stuck == 0) continue;
+			sprintf_s(line, sizeof(line), "%-10s | %-10s | %10lld | %18.2f | %10.1f",
+				dnames[d], SIM_STRATEGY_NAMES[s], stuck, (double)g.stuckRoomsSum / stuck, (double)g.stuckMovesSum / stuck);
+			cout << line << "\n";
+		}
+	}
+
+	// per-room averages (rooms are ordered; large catalogs show the first 50)
+	cout << "\nRoom                       | Strategy   | Reached    | Moves  | Hints  | Time(s)\n";
+	cout << "--------------------------------------------------------------------------------\n";
+	int shownRooms = totalRooms < 50 ? totalRooms : 50;
+	for (int r = 0; r < shownRooms; ++r) {
+		for (int s = 0; s < SIM_STRATEGY_COUNT; ++s) {
+			SimRoomStats &rs = total.rooms[s][r];
+			double n = rs.reached > 0 ? (double)rs.reached : 1.0;
+			sprintf_s(line, sizeof(line), "%-26.26s | %-10s | %10lld | %6.2f | %6.2f | %7.1f",
+				roomNames[r], SIM_STRATEGY_NAMES[s], rs.reached, rs.moves / n, rs.hints / n, rs.seconds / n);
+			cout << line << "\n";
+		}
+	}
+	if (shownRooms < totalRooms) cout << "(" << (totalRooms - shownRooms) << " more rooms not shown)\n";
+
+	for (int t = 0; t < threads; ++t) { freeSession(workers[t]->gs); delete queues[t]; delete workers[t]; }
+}
+
+/* ========== Session host ========== */
+
+// Runs many sessions side by side over the one shared catalog. Commands are
+// dealt round-robin, as a server interleaves its clients; a session that
+// finishes (or cannot go on) is destroyed and replaced by a fresh one.
+struct HostSlot {
+	GameSession* gs;
+	int inspected; // object (room-local) inspected by the last command, -1 = none
+	Rng rng;
+};
+
+GameSession* createSession(int difficulty, uint64_t seed) {
+	GameSession* gs = new(nothrow) GameSession();
+	if (!gs) { cerr << "Memory alloc failed\n"; exit(1); }
+	if (!allocSession(*gs)) exit(1);
+	engineNewGame(*gs, difficulty, seed);
+	return gs;
+}
+
+void destroySession(GameSession* gs) {
+	freeSession(*gs);
+	delete gs;
+}
+
+// Heap bytes a session holds (allocator overhead not included).
+size_t sessionBytes(const GameSession &gs) {
+	size_t b = sizeof(GameSession);
+	b += (size_t)solvedWordCount() * sizeof(unsigned int) + (size_t)totalRooms * sizeof(int) + (size_t)totalObjects * sizeof(int);
+	b += (size_t)gs.invCapacity * sizeof(int) + (size_t)itemWordCount() * sizeof(unsigned int);
+	b += gs.journalPending.capacity();
+	return b;
+}
+
+// Inventory slot of an item that unlocks the object, -1 if none does.
+int findUsableItem(GameSession &gs, int pos) {
+	for (int i = 0; i < gs.invCount; ++i) if (findInteraction(gs.inventory[i], pos) & USE_UNLOCK) return i;
+	return -1;
+}
 
-	// Build final object arrays
-	totalObjects = tempCount;
-	objectNames = new(nothrow) char*[totalObjects];
-	objectDescriptions = new(nothrow) char*[totalObjects];
-	objectHasPuzzle = new(nothrow) int[totalObjects];
-	objectPuzzleType = new(nothrow) int[totalObjects];
-	objectPuzzlePrompt = new(nothrow) char*[totalObjects];
-	objectPuzzleAnswer = new(nothrow) char*[totalObjects];
-	objectGivesItem = new(nothrow) int[totalObjects];
-	objectItemName = new(nothrow) char*[totalObjects];
-	objectSolved = new(nothrow) int[totalObjects];
-
-	if (!objectNames || !objectDescriptions || !objectHasPuzzle || !objectPuzzleType || !objectPuzzlePrompt || !objectPuzzleAnswer || !objectGivesItem || !objectItemName || !objectSolved) {
-		cerr << "Memory alloc failed\n"; freeAllMemory(); return false;
+// Picks the next command a player in this slot would send.
+void hostNextCommand(HostSlot &slot, EngineCommand &cmd, string &answer) {
+	GameSession &gs = *slot.gs;
+	int r = gs.currentRoomIndex;
+	int start = roomObjectStart[r];
+	int local = 0;
+	while (local < roomObjectCount[r] && isObjectSolved(gs, start + local)) ++local;
+	cmd.object = local;
+	cmd.item = -1;
+	cmd.text = nullptr;
+	int pos = start + local;
+	if (slot.inspected != local) { cmd.type = CMD_INSPECT; return; }
+	if (!objectHasPuzzle[pos]) { cmd.type = CMD_USE_ITEM; cmd.item = findUsableItem(gs, pos); return; }
+	int roll = rngRange(slot.rng, 1, 100);
+	if (roll <= 5) { cmd.type = CMD_HINT; return; }
+	cmd.type = CMD_ANSWER;
+	answer = roll <= 15 ? string("wrong") : string(answerSample(gs.puzzleSource[pos]));
+	cmd.text = answer.c_str();
+}
+
+int hostPercentile(vector<uint32_t> &v, double q) {
+	if (v.empty()) return 0;
+	size_t k = (size_t)(q * (v.size() - 1));
+	nth_element(v.begin(), v.begin() + k, v.end());
+	return (int)v[k];
+}
+
+void runHostBench(int sessions, long long commands) {
+	if (totalRooms == 0) { cout << "No rooms loaded.\n"; return; }
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	vector<HostSlot> slots((size_t)sessions);
+	for (int i = 0; i < sessions; ++i) {
+		rngSeed(slots[i].rng, (uint64_t)i + 1);
+		slots[i].gs = createSession(1 + i % 3, rngNext(slots[i].rng));
+		slots[i].inspected = -1;
 	}
+	double createMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+	size_t startBytes = 0;
+	for (int i = 0; i < sessions; ++i) startBytes += sessionBytes(*slots[i].gs);
 
-	// compute room object counts and starts
-	for (int r = 0; r < totalRooms; ++r) roomObjectCount[r] = 0;
-	for (int i = 0; i < totalObjects; ++i) {
-		int ridx = tempRoomIndex[i];
-		if (ridx >= 0 && ridx < totalRooms) ++roomObjectCount[ridx];
+	vector<uint32_t> latency;
+	latency.reserve((size_t)commands);
+	long long completed = 0, restarted = 0;
+	string answer;
+	EngineCommand cmd;
+	EngineResult res;
+	t0 = chrono::steady_clock::now();
+	for (long long n = 0; n < commands; ++n) {
+		HostSlot &slot = slots[(size_t)(n % sessions)];
+		hostNextCommand(slot, cmd, answer);
+		if (cmd.type == CMD_USE_ITEM && cmd.item < 0) {
+			// nothing left that could open this object: start over
+			destroySession(slot.gs);
+			slot.gs = createSession(1 + (int)(n % 3), rngNext(slot.rng));
+			slot.inspected = -1;
+			++restarted;
+			continue;
+		}
+		chrono::steady_clock::time_point c0 = chrono::steady_clock::now();
+		engineApply(*slot.gs, cmd, res);
+		latency.push_back((uint32_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - c0).count());
+		slot.inspected = cmd.type == CMD_INSPECT ? cmd.object : (res.solved ? -1 : slot.inspected);
+		if (cmd.type == CMD_USE_ITEM && res.status != ENGINE_OK) slot.inspected = -1;
+		if (res.gameCompleted) {
+			destroySession(slot.gs);
+			slot.gs = createSession(1 + (int)(n % 3), rngNext(slot.rng));
+			slot.inspected = -1;
+			++completed;
+		}
 	}
-	int accum = 0;
-	for (int r = 0; r < totalRooms; ++r) { roomObjectStart[r] = accum; accum += roomObjectCount[r]; }
+	double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
 
-	// fill objects into per-room order
-	int* cursor = new(nothrow) int[totalRooms];
-	for (int r = 0; r < totalRooms; ++r) cursor[r] = 0;
-	for (int i = 0; i < totalObjects; ++i) {
-		int ridx = tempRoomIndex[i];
-		int pos = roomObjectStart[ridx] + cursor[ridx];
-		char** f = tempFields[i];
-		objectNames[pos] = allocCstrFromStd(string(f[0]));
-		objectDescriptions[pos] = allocCstrFromStd(string(f[1]));
-		int ptype = safeAtoi(f[2]);
-		objectPuzzleType[pos] = ptype;
-		objectHasPuzzle[pos] = (ptype != 0) ? 1 : 0;
-		string prm = string(f[3]);
-		if (_stricmp(prm.c_str(), "NOPROMPT") == 0) prm = string("");
-		objectPuzzlePrompt[pos] = allocCstrFromStd(prm);
-		string ans = string(f[4]);
-		if (_stricmp(ans.c_str(), "NOANSWER") == 0) ans = string("");
-		objectPuzzleAnswer[pos] = allocCstrFromStd(ans);
-		string gv = string(f[5]);
-		int gflag = 0;
-		if (_stricmp(gv.c_str(), "1") == 0 || _stricmp(gv.c_str(), "YES") == 0) gflag = 1;
-		objectGivesItem[pos] = gflag;
-		string iname = string(f[6]);
-		if (_stricmp(iname.c_str(), "NOITEM") == 0) iname = string("");
-		objectItemName[pos] = allocCstrFromStd(iname);
-		objectSolved[pos] = 0;
-		++cursor[ridx];
-	}
-	delete[] cursor;
-
-	// cleanup temp
-	for (int i = 0; i < tempCount; ++i) {
-		char** ff = tempFields[i];
-		for (int k = 0; k < 7; ++k) delete[] ff[k];
-		delete[] ff;
-	}
-	delete[] tempFields;
-	delete[] tempRoomIndex;
-
-	cout << "Loaded " << totalRooms << " rooms and " << totalObjects << " objects.\n";
-	return true;
+	size_t endBytes = 0;
+	for (int i = 0; i < sessions; ++i) endBytes += sessionBytes(*slots[i].gs);
+	double perSession = (double)(startBytes > endBytes ? startBytes : endBytes) / sessions;
+	size_t catalogBytes = catalogTableBytes() + (catalogPackMapped ? (size_t)catalogPack.size : catalogArena.bytesUsed);
+	long long applied = (long long)latency.size();
+
+	char line[256];
+	sprintf_s(line, sizeof(line), "Hosted %d sessions (created in %.1f ms); %lld commands in %.2f s (%.0f commands/s).",
+		sessions, createMs, applied, secs, secs > 0 ? applied / secs : 0.0);
+	cout << line << "\n";
+	sprintf_s(line, sizeof(line), "Session memory: %.0f bytes each, catalog shared: %zu bytes -> about %.0f sessions per GB.",
+		perSession, catalogBytes, perSession > 0 ? 1073741824.0 / perSession : 0.0);
+	cout << line << "\n";
+	int p50 = hostPercentile(latency, 0.50), p99 = hostPercentile(latency, 0.99), pmax = hostPercentile(latency, 1.0);
+	sprintf_s(line, sizeof(line), "Command latency: p50 %.2f us, p99 %.2f us, max %.2f us.", p50 / 1000.0, p99 / 1000.0, pmax / 1000.0);
+	cout << line << "\n";
+	cout << "Games completed: " << completed << ", restarted: " << restarted << "\n";
+
+	for (int i = 0; i < sessions; ++i) destroySession(slots[i].gs);
 }
 
-/* ========== Randomize puzzles ========== */
+/* ========== Edit distance benchmark ========== */
 
-void randomizePuzzles() {
-	srand((unsigned int)time(nullptr));
-	for (int r = 0; r < totalRooms; ++r) {
-		int start = roomObjectStart[r];
-		int cnt = roomObjectCount[r];
-		int k = 0;
-		int* idx = new(nothrow) int[cnt];
-		for (int j = 0; j < cnt; ++j) if (objectHasPuzzle[start + j]) idx[k++] = start + j;
-		if (k > 1) {
-			for (int i = k - 1; i > 0; --i) {
-				int j = rand() % (i + 1);
-				int a = idx[i], b = idx[j];
-				// swap answers/prompts/types/givesitem/itemname/haspuzzle
-				char* ta = objectPuzzleAnswer[a]; objectPuzzleAnswer[a] = objectPuzzleAnswer[b]; objectPuzzleAnswer[b] = ta;
-				char* tp = objectPuzzlePrompt[a]; objectPuzzlePrompt[a] = objectPuzzlePrompt[b]; objectPuzzlePrompt[b] = tp;
-				int ttype = objectPuzzleType[a]; objectPuzzleType[a] = objectPuzzleType[b]; objectPuzzleType[b] = ttype;
-				int thp = objectHasPuzzle[a]; objectHasPuzzle[a] = objectHasPuzzle[b]; objectHasPuzzle[b] = thp;
-				int tgi = objectGivesItem[a]; objectGivesItem[a] = objectGivesItem[b]; objectGivesItem[b] = tgi;
-				char* ti = objectItemName[a]; objectItemName[a] = objectItemName[b]; objectItemName[b] = ti;
-			}
+// Textbook O(m*n) dynamic program: the reference --bench-levenshtein
+// checks and times the bit-parallel version against.
+int naiveEditDistance(const string &a, const string &b) {
+	vector<int> prev(b.size() + 1), cur(b.size() + 1);
+	for (size_t j = 0; j <= b.size(); ++j) prev[j] = (int)j;
+	for (size_t i = 1; i <= a.size(); ++i) {
+		cur[0] = (int)i;
+		for (size_t j = 1; j <= b.size(); ++j) {
+			int sub = prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+			cur[j] = min(sub, min(prev[j], cur[j - 1]) + 1);
 		}
-		delete[] idx;
+		swap(prev, cur);
 	}
+	return prev[b.size()];
 }
 
-/* ========== Puzzle check & inspect ========== */
-
-bool checkPuzzleAnswerByIndex(int objIndex, const string &userInput) {
-	if (objIndex < 0 || objIndex >= totalObjects) return false;
-	if (!objectHasPuzzle[objIndex]) return true;
-	string correct = toLowerTrim(string(objectPuzzleAnswer[objIndex]));
-	if (objectPuzzleType[objIndex] == 1) {
-		int a = safeAtoi(correct.c_str());
-		int b = safeAtoi(userInput.c_str());
-		return a == b;
+// Escape.exe --bench-levenshtein [pairs]: answer-sized words and copies of
+// them with up to three random typos.
+void runLevenshteinBench(int pairs) {
+	Rng rng;
+	rngSeed(rng, 18);
+	vector<string> answers((size_t)pairs), typed((size_t)pairs);
+	for (int i = 0; i < pairs; ++i) {
+		string w;
+		int len = rngRange(rng, 3, 24);
+		for (int k = 0; k < len; ++k) w.push_back((char)('a' + rngRange(rng, 0, 25)));
+		string t = w;
+		int edits = rngRange(rng, 0, 3);
+		for (int e = 0; e < edits && !t.empty(); ++e) {
+			size_t at = (size_t)rngRange(rng, 0, (int)t.size() - 1);
+			int op = rngRange(rng, 0, 2);
+			char c = (char)('a' + rngRange(rng, 0, 25));
+			if (op == 0) t[at] = c;
+			else if (op == 1) t.insert(t.begin() + at, c);
+			else t.erase(t.begin() + at);
+		}
+		answers[i] = w;
+		typed[i] = t;
 	}
-	else {
-		return toLowerTrim(userInput) == correct;
+	int mismatches = 0;
+	for (int i = 0; i < pairs; ++i) {
+		if (editDistance(answers[i].data(), (int)answers[i].size(), typed[i].data(), typed[i].size()) != naiveEditDistance(answers[i], typed[i])) ++mismatches;
 	}
+
+	int rounds = pairs >= 1000000 ? 1 : 1000000 / pairs;
+	long long sum = 0;
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	for (int r = 0; r < rounds; ++r)
+		for (int i = 0; i < pairs; ++i) sum += editDistance(answers[i].data(), (int)answers[i].size(), typed[i].data(), typed[i].size());
+	double myersNs = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / ((double)rounds * pairs);
+	t0 = chrono::steady_clock::now();
+	for (int r = 0; r < rounds; ++r)
+		for (int i = 0; i < pairs; ++i) sum -= naiveEditDistance(answers[i], typed[i]);
+	double naiveNs = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / ((double)rounds * pairs);
+
+	char line[256];
+	sprintf_s(line, sizeof(line), "%d pair(s) x %d round(s), answers of 3-24 letters with 0-3 typos.", pairs, rounds);
+	cout << line << "\n";
+	sprintf_s(line, sizeof(line), "Bit-parallel (Myers): %.1f ns per check; dynamic program: %.1f ns per check (%.1fx).", myersNs, naiveNs, myersNs > 0 ? naiveNs / myersNs : 0.0);
+	cout << line << "\n";
+	cout << (mismatches == 0 && sum == 0 ? "Both agree on every pair.\n" : "Distances DISAGREE on some pairs!\n");
 }
 
-void inspectObjectInRoom(int roomIdx, int localIndex) {
-	int pos = roomObjectStart[roomIdx] + localIndex;
-	clearScreen();
-	cout << "Inspecting: " << objectNames[pos] << "\n\n";
-	cout << objectDescriptions[pos] << "\n\n";
-	if (objectSolved[pos]) {
-		cout << "(Already solved)\n";
-		pressEnterToContinue();
-		return;
-	}
-	if (!objectHasPuzzle[pos]) {
-		cout << "No puzzle here.\n";
-		if (objectGivesItem[pos] && strlen(objectItemName[pos]) > 0) {
-			addInventory(objectItemName[pos]);
-			objectSolved[pos] = 1;
-		}
-		pressEnterToContinue();
-		return;
-	}
-	cout << "Puzzle prompt:\n";
-	if (strlen(objectPuzzlePrompt[pos]) > 0) cout << objectPuzzlePrompt[pos] << "\n\n";
-	else cout << "(No prompt available)\n\n";
-	cout << "Options:\n1. Try to solve\n2. Ask for a hint (penalty)\n3. Back\nChoose: ";
-	int choice = readIntInRange(1, 3);
-	if (choice == 2) {
-		string ans = objectPuzzleAnswer[pos];
-		if (objectPuzzleType[pos] == 1) {
-			int v = safeAtoi(ans.c_str());
-			cout << "HINT: The number is between " << (v / 2) << " and " << (v + 5) << ".\n";
-		}
-		else {
-			string low = toLowerTrim(ans);
-			if (low.size() >= 2) cout << "HINT: Starts with '" << low.substr(0, 2) << "'.\n";
-			else if (low.size() == 1) cout << "HINT: Starts with '" << low[0] << "'.\n";
-			else cout << "HINT: Look around closely.\n";
+/* ========== Text primitives benchmark ========== */
+
+// Escape.exe --bench-text [rooms file] [rounds] runs the loader's per-line
+// work (trim, keyword tests, digit check) over a rooms file with the byte
+// loops and with the vector primitives.
+const char* const BENCH_KEYWORDS[] = { "ROOM", "OBJECT", "OBJECTS", "NOPROMPT", "NOANSWER", "NOITEM" };
+const int BENCH_KEYWORD_COUNT = 6;
+
+template <bool Vector>
+long long scanCatalogText(const char* p, const char* end) {
+	size_t kwLen[BENCH_KEYWORD_COUNT];
+	for (int k = 0; k < BENCH_KEYWORD_COUNT; ++k) kwLen[k] = strlen(BENCH_KEYWORDS[k]);
+	long long tally = 0;
+	TextCursor c;
+	c.p = p;
+	c.end = end;
+	while (c.p < end) {
+		const char* s = nullptr;
+		size_t n = 0;
+		if (Vector) nextLine(c, s, n);
+		else nextLineScalar(c, s, n);
+		tally += (long long)n;
+		for (int k = 0; k < BENCH_KEYWORD_COUNT; ++k) {
+			if (kwLen[k] == n && (Vector ? foldedEquals(s, BENCH_KEYWORDS[k], n) : foldedEqualsScalar(s, BENCH_KEYWORDS[k], n))) tally += k + 1;
 		}
-		++hintsUsed;
-		pressEnterToContinue();
-		return;
-	}
-	else if (choice == 3) {
-		return;
+		if (n > 0 && (Vector ? allDigits(s, n) : allDigitsScalar(s, n))) tally += 1000;
 	}
-	cout << "Enter your answer: ";
-	string user = readLineTrimmedFromCin();
-	if (user.size() == 0) {
-		cout << "No answer entered.\n";
-		pressEnterToContinue();
-		return;
+	return tally;
+}
+
+void runTextBench(const char* fname, int rounds) {
+	MappedFile mf;
+	if (!mapFileReadOnly(fname, mf)) { cout << "Unable to open '" << fname << "'.\n"; return; }
+	// read through a volatile so every round really scans the text
+	const char* volatile text = mf.data;
+	const char* end = mf.data + mf.size;
+	long long scalarTally = 0, vectorTally = 0;
+	// the passes alternate and the best round of each counts, which keeps
+	// the ratio steady on a busy machine
+	double scalarSecs = 1e30, vectorSecs = 1e30;
+	for (int r = 0; r < rounds; ++r) {
+		chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+		scalarTally += scanCatalogText<false>(text, end);
+		chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+		vectorTally += scanCatalogText<true>(text, end);
+		chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+		scalarSecs = min(scalarSecs, chrono::duration<double>(t1 - t0).count());
+		vectorSecs = min(vectorSecs, chrono::duration<double>(t2 - t1).count());
 	}
-	if (checkPuzzleAnswerByIndex(pos, user)) {
-		cout << "Correct! Puzzle solved.\n";
-		objectSolved[pos] = 1;
-		if (objectGivesItem[pos] && strlen(objectItemName[pos]) > 0) addInventory(objectItemName[pos]);
+
+	double mb = (double)mf.size / (1024.0 * 1024.0);
+	char line[256];
+	sprintf_s(line, sizeof(line), "%s: %.1f MB, best of %d round(s); vector width %d bytes.", fname, mb, rounds, TEXT_SIMD_WIDTH);
+	cout << line << "\n";
+	sprintf_s(line, sizeof(line), "Byte loops: %.0f MB/s; vector primitives: %.0f MB/s (%.2fx).",
+		scalarSecs > 0 ? mb / scalarSecs : 0.0, vectorSecs > 0 ? mb / vectorSecs : 0.0, vectorSecs > 0 ? scalarSecs / vectorSecs : 0.0);
+	cout << line << "\n";
+	cout << (scalarTally == vectorTally ? "Both agree on every line.\n" : "Results DISAGREE!\n");
+	unmapFile(mf);
+}
+
+/* ========== TCP game server ========== */
+
+// Escape.exe --server [port] [threads] runs the console's menus and room
+// commands over a line protocol on 127.0.0.1. Each connection is its own
+// GameSession whose playerMain coroutine sits suspended on the next line;
+// each event-loop thread owns its connections outright, so threads share
+// only read-only catalog versions, and a loop binds the version of the
+// connection it serves. Every reply ends with the next prompt.
+const size_t NET_MAX_LINE = 4096;
+const int NET_DEFAULT_PORT = 4000;
+
+Task<void> playerMain(GameSession &gs, PlayerIO &io);
+uint64_t sessionDigest(GameSession &gs);
+atomic<long long> netTraceSequence(0);
+
+// Appends whatever the session prints to its connection's pending output.
+struct NetOutBuf : streambuf {
+	string* dst = nullptr;
+	int overflow(int ch) override {
+		if (!traits_type::eq_int_type(ch, traits_type::eof())) dst->push_back((char)ch);
+		return ch;
 	}
-	else {
-		cout << "Incorrect answer. Try again later.\n";
+	streamsize xsputn(const char* s, streamsize n) override {
+		dst->append(s, (size_t)n);
+		return n;
 	}
-	pressEnterToContinue();
+};
+
+struct NetConn {
+	int fd;
+	size_t slot;           // index in the owning loop's connection list
+	GameSession* gs;
+	PlayerIO io;
+	NetOutBuf outBuf;
+	ostream outStream{ &outBuf };
+	Task<void> session;    // playerMain, suspended on the next line
+	string in;             // received bytes without a newline yet
+	string out;            // reply bytes not yet written
+	size_t outSent;
+	bool closing;          // close once 'out' has been written
+	bool writeArmed;
+};
+
+#ifdef __linux__
+
+volatile sig_atomic_t netStopRequested = 0;
+
+void netOnSignal(int) {
+	netStopRequested = 1;
 }
 
-/* ========== Room play loop ========== */
+void raiseFileLimit() {
+	struct rlimit rl;
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+}
 
-void showRoomAscii(int r) {
-	cout << "\nRoom Layout (ASCII visual)\n";
-	cout << "---------------------------\n";
-	cout << "[ Door ]              [ ";
-	int cnt = roomObjectCount[r];
-	if (cnt > 0) cout << objectNames[roomObjectStart[r]];
-	else cout << " ";
-	cout << " ]\n";
-	if (cnt > 1) cout << "[ Shelf ]          [ " << objectNames[roomObjectStart[r] + 1] << " ]\n";
-	cout << "---------------------------\n";
+// Non-blocking listener on 127.0.0.1; SO_REUSEPORT lets every loop thread
+// have its own and the kernel spreads new connections across them.
+int netListen(int port) {
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	int one = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((uint16_t)port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) { close(fd); return -1; }
+	return fd;
 }
 
-int computeScore() {
-	int elapsed = accumulatedElapsed + (int)difftime(time(nullptr), startTime);
-	int score = 100;
-	score -= elapsed / 10;
-	score -= hintsUsed * 5;
-	score -= totalMoves / 2;
-	if (difficultyLevel == 3) score += 10;
-	if (difficultyLevel == 1) score -= 5;
-	if (score < 0) score = 0;
-	if (score > 100) score = 100;
-	return score;
+struct NetLoop {
+	int epfd;
+	int listenFd;
+	vector<NetConn*> conns;
+	long long accepted;
+	long long lines;
+};
+
+void netClose(NetLoop &loop, NetConn* c) {
+	bindCatalog(c->gs->catalog.get());
+	epoll_ctl(loop.epfd, EPOLL_CTL_DEL, c->fd, nullptr);
+	close(c->fd);
+	loop.conns[c->slot] = loop.conns.back();
+	loop.conns[c->slot]->slot = c->slot;
+	loop.conns.pop_back();
+	if (c->io.trace) {
+		traceClose(*c->io.trace, sessionDigest(*c->gs));
+		delete c->io.trace;
+	}
+	GameSession* gs = c->gs;
+	delete c; // the session's coroutine frames go before the state they point at
+	destroySession(gs);
 }
 
-// forward declarations
-void saveProgress();
-bool loadProgress();
-
-bool isRoomCompleted(int roomIdx) {
-	int start = roomObjectStart[roomIdx];
-	int count = roomObjectCount[roomIdx];
-	for (int i = 0; i < count; i++) {
-		if (!objectSolved[start + i]) {
-			return false;
-		}
+// Writes as much pending output as the socket takes; false once the connection should go.
+bool netFlush(NetLoop &loop, NetConn &c) {
+	while (c.outSent < c.out.size()) {
+		ssize_t w = send(c.fd, c.out.data() + c.outSent, c.out.size() - c.outSent, MSG_NOSIGNAL);
+		if (w > 0) { c.outSent += (size_t)w; continue; }
+		if (w < 0 && errno == EINTR) continue;
+		if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+		return false;
+	}
+	if (c.outSent == c.out.size()) {
+		c.out.clear();
+		c.outSent = 0;
+		if (c.closing) return false;
+	}
+	bool want = !c.out.empty();
+	if (want != c.writeArmed) {
+		epoll_event ev;
+		ev.events = EPOLLIN | (want ? (uint32_t)EPOLLOUT : 0u);
+		ev.data.ptr = &c;
+		epoll_ctl(loop.epfd, EPOLL_CTL_MOD, c.fd, &ev);
+		c.writeArmed = want;
 	}
 	return true;
 }
 
-void playRoomLoop(int r) {
+// Reads what is available and answers every complete line; false on EOF or error.
+bool netRead(NetLoop &loop, NetConn &c) {
+	bindCatalog(c.gs->catalog.get());
+	char buf[4096];
+	bool open = true;
 	while (true) {
-		clearScreen();
-		int elapsed = accumulatedElapsed + (int)difftime(time(nullptr), startTime);
-		cout << "Room: " << roomNames[r] << "    Time: " << elapsed << " sec\n";
-		showRoomAscii(r);
-		cout << "\nObjects:\n";
-		int cnt = roomObjectCount[r];
-		for (int i = 0; i < cnt; ++i) {
-			int pos = roomObjectStart[r] + i;
-			cout << (i + 1) << ". " << objectNames[pos];
-			if (objectSolved[pos]) cout << " (solved)";
-			cout << "\n";
-		}
-		cout << "I. Inventory\nS. Save Game\nQ. Quit to Main Menu\n";
-		cout << "\nEnter choice (number/I/S/Q): ";
-		string cmd = readLineTrimmedFromCin();
-		if (cmd.size() == 0) continue;
-		if ((cmd == "I") || (cmd == "i")) {
-			showInventory();
-			if (invCount > 0) {
-				cout << "Do you want to use an item? (y/n): ";
-				if (readYesNo()) {
-					cout << "Enter item number to use: ";
-					int idx = readIntInRange(1, invCount) - 1;
-					if (idx < 0 || idx >= invCount) { cout << "Invalid index.\n"; pressEnterToContinue(); continue; }
-					if (roomObjectCount[r] == 0) {
-						cout << "No objects in this room to use item on.\n";
-						pressEnterToContinue();
-						continue;
-					}
-					cout << "Choose target object to use this on (1-" << roomObjectCount[r] << "): ";
-					int targ = readIntInRange(1, roomObjectCount[r]) - 1;
-					int pos = roomObjectStart[r] + targ;
-					string it = toLowerTrim(string(inventory[idx]));
-					string oname = toLowerTrim(string(objectNames[pos]));
-					string odesc = toLowerTrim(string(objectDescriptions[pos]));
-					bool used = false;
-					if (it.find("key") != string::npos && (oname.find("door") != string::npos || oname.find("lock") != string::npos || odesc.find("lock") != string::npos)) {
-						cout << "The key fits and unlocks the object!\n";
-						objectSolved[pos] = 1;
-						used = true;
-					}
-					else {
-						cout << "Using the item had no noticeable effect.\n";
-					}
-					if (used) {
-						cout << "Consume item after use? (y/n): ";
-						if (readYesNo()) removeInventoryAt(idx);
-					}
-				}
-			}
-			pressEnterToContinue();
-			continue;
-		}
-		else if ((cmd == "S") || (cmd == "s")) {
-			saveProgress();
-			pressEnterToContinue();
-			continue;
-		}
-		else if ((cmd == "Q") || (cmd == "q")) {
-			cout << "Quit to main menu? (y/n): ";
-			if (readYesNo()) {
-				// signal outer loops to stop and return to main menu
-				exitToMainRequested = true;
-				return;
-			}
-			else continue;
-		}
-		else {
-			bool allDigits = true;
-			for (size_t i = 0; i < cmd.size(); ++i) if (!isdigit((unsigned char)cmd[i])) { allDigits = false; break; }
-			if (!allDigits) { cout << "Invalid command.\n"; pressEnterToContinue(); continue; }
-			int num = safeAtoi(cmd.c_str());
-			if (num < 1 || num > roomObjectCount[r]) { cout << "Invalid object number.\n"; pressEnterToContinue(); continue; }
-			++totalMoves;
-			inspectObjectInRoom(r, num - 1);
+		ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+		if (n > 0) { c.in.append(buf, (size_t)n); continue; }
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+		open = false;
+		break;
+	}
+	size_t start = 0, nl;
+	while (!c.closing && (nl = c.in.find('\n', start)) != string::npos) {
+		feedLine(c.io, c.in.substr(start, nl - start));
+		start = nl + 1;
+		++loop.lines;
+		if (c.session.done()) c.closing = true;
+	}
+	c.in.erase(0, start);
+	return open && c.in.size() <= NET_MAX_LINE;
+}
 
-			// Check if room is completed after solving an object
-			if (isRoomCompleted(r)) {
-				cout << "\n🎉 All objects in this room are solved! Door unlocked!\n";
-				if (r < totalRooms - 1) {
-					cout << "Moving to next room...\n";
-				}
-				else {
-					cout << "Final room completed! You've escaped!\n";
-				}
-				pressEnterToContinue();
-				return; // Exit room loop to proceed to next room
-			}
+void netAccept(NetLoop &loop) {
+	while (true) {
+		int fd = accept4(loop.listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			return; // EAGAIN, or out of descriptors until some close
 		}
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		NetConn* c = new(nothrow) NetConn();
+		if (!c) { close(fd); continue; }
+		c->fd = fd;
+		c->gs = new(nothrow) GameSession();
+		if (!c->gs || !allocSession(*c->gs)) { close(fd); delete c->gs; delete c; continue; }
+		epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.ptr = c;
+		if (epoll_ctl(loop.epfd, EPOLL_CTL_ADD, fd, &ev) != 0) { close(fd); destroySession(c->gs); delete c; continue; }
+		c->slot = loop.conns.size();
+		loop.conns.push_back(c);
+		++loop.accepted;
+		c->outBuf.dst = &c->out;
+		c->io.out = &c->outStream;
+		c->io.network = true;
+		if (!tracePath.empty()) {
+			TraceWriter* t = new(nothrow) TraceWriter();
+			if (t && traceOpen(*t, tracePath + "." + to_string(++netTraceSequence), true)) c->io.trace = t;
+			else delete t;
+		}
+		c->out = "Welcome to the ESCAPE ROOM SIMULATOR.\n";
+		c->session = playerMain(*c->gs, c->io);
+		c->session.start();
+		if (!netFlush(loop, *c)) netClose(loop, c);
 	}
 }
 
-/* ========== Save / Load binary ========== */
-
-void saveProgress() {
-	ofstream fout(SAVE_BIN, ios::binary);
-	if (!fout) { cout << "Failed to open save file for writing.\n"; return; }
-	fout.write("ESCP1", 5);
-	unsigned char version = 1;
-	fout.write((char*)&version, 1);
-	unsigned char diff = (unsigned char)difficultyLevel;
-	fout.write((char*)&diff, 1);
-	fout.write((char*)&currentRoomIndex, sizeof(int));
-	fout.write((char*)&totalMoves, sizeof(int));
-	fout.write((char*)&hintsUsed, sizeof(int));
-	int elapsed = accumulatedElapsed + (int)difftime(time(nullptr), startTime);
-	fout.write((char*)&elapsed, sizeof(int));
-	// inventory
-	fout.write((char*)&invCount, sizeof(int));
-	for (int i = 0; i < invCount; ++i) {
-		int len = (int)strlen(inventory[i]);
-		fout.write((char*)&len, sizeof(int));
-		if (len > 0) fout.write(inventory[i], len);
-	}
-	// object flags
-	fout.write((char*)&totalObjects, sizeof(int));
-	for (int i = 0; i < totalObjects; ++i) {
-		unsigned char f = (unsigned char)(objectSolved[i] ? 1 : 0);
-		fout.write((char*)&f, 1);
+void netLoopMain(NetLoop* loop) {
+	epoll_event events[256];
+	while (!netStopRequested) {
+		int n = epoll_wait(loop->epfd, events, 256, 500);
+		for (int i = 0; i < n; ++i) {
+			if (!events[i].data.ptr) { netAccept(*loop); continue; }
+			NetConn* c = (NetConn*)events[i].data.ptr;
+			bool keep = !(events[i].events & EPOLLERR);
+			if (keep && (events[i].events & (EPOLLIN | EPOLLHUP))) keep = netRead(*loop, *c);
+			if (keep) keep = netFlush(*loop, *c);
+			else netFlush(*loop, *c); // best effort for a final "Goodbye!"
+			if (!keep) netClose(*loop, c);
+		}
 	}
-	fout.close();
-	cout << "Saving to " << SAVE_BIN << "...\n";
-	cout << "✅ Progress saved successfully!\n";
+	while (!loop->conns.empty()) netClose(*loop, loop->conns.back());
 }
 
-bool loadProgress() {
-	if (!fileExists(SAVE_BIN)) { cout << "No save file found.\n"; return false; }
-	ifstream fin(SAVE_BIN, ios::binary);
-	if (!fin) { cout << "Failed to open save file.\n"; return false; }
-	char magic[6]; memset(magic, 0, sizeof(magic));
-	fin.read(magic, 5);
-	if (fin.gcount() != 5 || strncmp(magic, "ESCP1", 5) != 0) { cout << "Invalid or corrupted save file.\n"; fin.close(); return false; }
-	unsigned char version = 0; fin.read((char*)&version, 1);
-	unsigned char diff = 0; fin.read((char*)&diff, 1);
-	int cRoom = 0; fin.read((char*)&cRoom, sizeof(int));
-	int tMoves = 0; fin.read((char*)&tMoves, sizeof(int));
-	int hUsed = 0; fin.read((char*)&hUsed, sizeof(int));
-	int elapsed = 0; fin.read((char*)&elapsed, sizeof(int));
-	int inv = 0; fin.read((char*)&inv, sizeof(int));
-	// clear current inventory
-	for (int i = 0; i < invCount; ++i) delete[] inventory[i];
-	delete[] inventory; inventory = nullptr; invCount = 0; invCapacity = 0;
-	if (inv < 0) inv = 0;
-	invCapacity = inv > 0 ? inv : 4;
-	inventory = new(nothrow) char*[invCapacity];
-	if (!inventory) { cerr << "Memory alloc failed\n"; exit(1); }
-	for (int i = 0; i < inv; ++i) {
-		int len = 0; fin.read((char*)&len, sizeof(int));
-		if (len <= 0) { inventory[invCount++] = allocEmptyCstr(); continue; }
-		char* buf = new(nothrow) char[len + 1];
-		if (!buf) { cerr << "Memory alloc failed\n"; exit(1); }
-		fin.read(buf, len); buf[len] = 0; inventory[invCount++] = buf;
+void runServer(int port, int threads) {
+	if (threads < 1) threads = 1;
+	raiseFileLimit();
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, netOnSignal);
+	signal(SIGTERM, netOnSignal);
+	vector<NetLoop> loops((size_t)threads);
+	for (int t = 0; t < threads; ++t) {
+		loops[t].listenFd = netListen(port);
+		loops[t].epfd = epoll_create1(EPOLL_CLOEXEC);
+		loops[t].accepted = 0;
+		loops[t].lines = 0;
+		if (loops[t].listenFd < 0 || loops[t].epfd < 0) {
+			cout << "Unable to listen on 127.0.0.1:" << port << ".\n";
+			for (int k = 0; k <= t; ++k) { if (loops[k].listenFd >= 0) close(loops[k].listenFd); if (loops[k].epfd >= 0) close(loops[k].epfd); }
+			return;
+		}
+		epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.ptr = nullptr;
+		epoll_ctl(loops[t].epfd, EPOLL_CTL_ADD, loops[t].listenFd, &ev);
 	}
-	int fileTotalObjects = 0; fin.read((char*)&fileTotalObjects, sizeof(int));
-	if (fileTotalObjects != totalObjects) { cout << "Save file object count mismatch; cannot load.\n"; fin.close(); return false; }
-	for (int i = 0; i < totalObjects; ++i) {
-		unsigned char f = 0; fin.read((char*)&f, 1);
-		objectSolved[i] = (int)f;
+	cout << "Serving on 127.0.0.1:" << port << " with " << threads << " event loop thread(s). Press Ctrl+C to stop.\n";
+	vector<thread> pool;
+	for (int t = 0; t < threads; ++t) pool.push_back(thread(netLoopMain, &loops[t]));
+	for (size_t t = 0; t < pool.size(); ++t) pool[t].join();
+	long long accepted = 0, lines = 0;
+	for (int t = 0; t < threads; ++t) {
+		accepted += loops[t].accepted;
+		lines += loops[t].lines;
+		close(loops[t].listenFd);
+		close(loops[t].epfd);
 	}
-	fin.close();
-	difficultyLevel = (int)diff;
-	currentRoomIndex = cRoom;
-	totalMoves = tMoves;
-	hintsUsed = hUsed;
-	accumulatedElapsed = elapsed;
-	startTime = time(nullptr) - accumulatedElapsed;
-	cout << "Save loaded successfully. Resuming from room " << (currentRoomIndex + 1) << ".\n";
-	return true;
+	cout << "Server stopped after " << accepted << " connection(s) and " << lines << " command(s).\n";
 }
 
-/* ========== High scores ========== */
-
-void appendHighScore(const char* name, int score, int timeSec, int diff, int hints) {
-	ofstream fout(HIGHSCORES_BIN, ios::binary | ios::app);
-	if (!fout) { cout << "Unable to open high score file for writing.\n"; return; }
-	int len = (int)strlen(name);
-	fout.write((char*)&len, sizeof(int));
-	if (len > 0) fout.write(name, len);
-	unsigned char d = (unsigned char)diff;
-	fout.write((char*)&d, 1);
-	fout.write((char*)&timeSec, sizeof(int));
-	fout.write((char*)&score, sizeof(int));
-	unsigned short hs = (unsigned short)hints;
-	fout.write((char*)&hs, sizeof(unsigned short));
-	fout.close();
-	cout << "High score recorded.\n";
-}
+/* ========== Load generator ========== */
 
-void showHighScores() {
-	if (!fileExists(HIGHSCORES_BIN)) { cout << "No high scores yet.\n"; return; }
-	ifstream fin(HIGHSCORES_BIN, ios::binary);
-	if (!fin) { cout << "Unable to open high score file.\n"; return; }
-	fin.seekg(0, ios::end);
-	streamoff sz = fin.tellg();
-	fin.seekg(0, ios::beg);
-	if (sz <= 0) { cout << "No records.\n"; fin.close(); return; }
-
-	int cap = 64; int cnt = 0;
-	char** names = new(nothrow) char*[cap];
-	unsigned char* diffs = new(nothrow) unsigned char[cap];
-	int* timesec = new(nothrow) int[cap];
-	int* scores = new(nothrow) int[cap];
-	unsigned short* hintsArr = new(nothrow) unsigned short[cap];
-	if (!names || !diffs || !timesec || !scores || !hintsArr) { cerr << "Memory alloc failed\n"; fin.close(); return; }
+// Escape.exe --loadgen [port] [connections] [active] [commands]
+// Opens 'connections' sessions; all but 'active' of them stay idle while the
+// active ones send 'commands' lines each (inspect object 1, back out, ...)
+// one at a time and time each round trip. A reply is complete when it ends
+// with a prompt (": " or "Press Enter to continue...").
+struct LoadConn {
+	int fd;
+	string in;
+	int phase; // 0 = awaiting the main menu, 1 = "new game" sent, 2 = difficulty sent, 3 = measuring
+	long long sent;
+	chrono::steady_clock::time_point at;
+};
 
-	while (fin.peek() != EOF) {
-		int nlen = 0;
-		fin.read((char*)&nlen, sizeof(int));
-		if (fin.eof()) break;
-		char* nbuf = new(nothrow) char[nlen + 1];
-		if (!nbuf) { cerr << "Memory alloc failed\n"; break; }
-		if (nlen > 0) fin.read(nbuf, nlen);
-		nbuf[nlen] = 0;
-		unsigned char d = 0; fin.read((char*)&d, 1);
-		int t = 0; fin.read((char*)&t, sizeof(int));
-		int sc = 0; fin.read((char*)&sc, sizeof(int));
-		unsigned short hs = 0; fin.read((char*)&hs, sizeof(unsigned short));
-		if (cnt >= cap) {
-			int nc = cap * 2;
-			char** n1 = new(nothrow) char*[nc];
-			unsigned char* n2 = new(nothrow) unsigned char[nc];
-			int* n3 = new(nothrow) int[nc];
-			int* n4 = new(nothrow) int[nc];
-			unsigned short* n5 = new(nothrow) unsigned short[nc];
-			for (int i = 0; i < cnt; ++i) { n1[i] = names[i]; n2[i] = diffs[i]; n3[i] = timesec[i]; n4[i] = scores[i]; n5[i] = hintsArr[i]; }
-			delete[] names; delete[] diffs; delete[] timesec; delete[] scores; delete[] hintsArr;
-			names = n1; diffs = n2; timesec = n3; scores = n4; hintsArr = n5;
-			cap = nc;
-		}
-		names[cnt] = nbuf;
-		diffs[cnt] = d;
-		timesec[cnt] = t;
-		scores[cnt] = sc;
-		hintsArr[cnt] = hs;
-		++cnt;
+bool loadSendLine(LoadConn &c, const char* line) {
+	string s = string(line) + "\n";
+	size_t done = 0;
+	while (done < s.size()) {
+		ssize_t w = send(c.fd, s.data() + done, s.size() - done, MSG_NOSIGNAL);
+		if (w > 0) { done += (size_t)w; continue; }
+		if (w < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+		return false;
 	}
-	fin.close();
-	if (cnt == 0) { cout << "No high scores.\n"; return; }
+	c.at = chrono::steady_clock::now();
+	return true;
+}
 
-	// bubble sort by score desc
-	for (int i = 0; i < cnt; ++i) {
-		for (int j = 0; j < cnt - 1 - i; ++j) {
-			if (scores[j] < scores[j + 1]) {
-				char* t0 = names[j]; names[j] = names[j + 1]; names[j + 1] = t0;
-				unsigned char t1 = diffs[j]; diffs[j] = diffs[j + 1]; diffs[j + 1] = t1;
-				int t2 = timesec[j]; timesec[j] = timesec[j + 1]; timesec[j + 1] = t2;
-				int t3 = scores[j]; scores[j] = scores[j + 1]; scores[j + 1] = t3;
-				unsigned short t4 = hintsArr[j]; hintsArr[j] = hintsArr[j + 1]; hintsArr[j + 1] = t4;
-			}
+void runLoadGen(int port, int connections, int active, long long commands) {
+	if (active > connections) active = connections;
+	raiseFileLimit();
+	signal(SIGPIPE, SIG_IGN);
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((uint16_t)port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	int ep = epoll_create1(EPOLL_CLOEXEC);
+	vector<LoadConn> conns;
+	conns.reserve((size_t)connections);
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	for (int i = 0; i < connections; ++i) {
+		int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+			if (fd >= 0) close(fd);
+			cout << "Connection " << (i + 1) << " failed: " << strerror(errno) << "\n";
+			break;
 		}
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		LoadConn c;
+		c.fd = fd;
+		c.phase = 0;
+		c.sent = 0;
+		conns.push_back(c);
+	}
+	double connectSecs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+	if (active > (int)conns.size()) active = (int)conns.size();
+	for (int i = 0; i < active; ++i) {
+		epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.u32 = (uint32_t)i;
+		epoll_ctl(ep, EPOLL_CTL_ADD, conns[i].fd, &ev);
 	}
+	cout << "Opened " << conns.size() << " connection(s) in " << connectSecs << " s; " << active << " active.\n";
 
-	cout << "===== HIGH SCORES =====\n";
-	cout << "# | Player                | Difficulty | Time   | Score | Hints\n";
-	cout << "---------------------------------------------------------------\n";
-	int limit = cnt < 20 ? cnt : 20;
-	for (int i = 0; i < limit; ++i) {
-		string dstr = (diffs[i] == 1 ? "Easy" : (diffs[i] == 2 ? "Medium" : "Hard"));
-		int mm = timesec[i] / 60; int ss = timesec[i] % 60;
-		char timestr[16]; sprintf_s(timestr, "%02d:%02d", mm, ss);
-		cout << setw(2) << (i + 1) << " | " << left << setw(21) << names[i] << " | " << setw(9) << dstr << " | " << timestr << " | " << setw(5) << scores[i] << " | " << setw(5) << hintsArr[i] << "\n";
+	static const char* script[] = { "1", "3" };
+	vector<uint32_t> latency;
+	latency.reserve((size_t)(active * commands));
+	int running = active;
+	epoll_event events[256];
+	t0 = chrono::steady_clock::now();
+	while (running > 0) {
+		int n = epoll_wait(ep, events, 256, 5000);
+		if (n == 0) { cout << "Timed out waiting for the server.\n"; break; }
+		for (int i = 0; i < n; ++i) {
+			LoadConn &c = conns[events[i].data.u32];
+			char buf[8192];
+			ssize_t r;
+			bool closed = false;
+			while ((r = recv(c.fd, buf, sizeof(buf), 0)) > 0) c.in.append(buf, (size_t)r);
+			if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) closed = true;
+			bool prompt = (c.in.size() >= 2 && c.in.compare(c.in.size() - 2, 2, ": ") == 0) ||
+				(c.in.size() >= 3 && c.in.compare(c.in.size() - 3, 3, "...") == 0);
+			if (prompt) {
+				c.in.clear();
+				if (c.phase == 3) latency.push_back((uint32_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - c.at).count());
+				bool ok = true;
+				if (c.phase == 0) { ok = loadSendLine(c, "1"); c.phase = 1; }
+				else if (c.phase == 1) { ok = loadSendLine(c, "2"); c.phase = 2; }
+				else if (c.phase == 2 || c.sent < commands) {
+					c.phase = 3;
+					ok = loadSendLine(c, script[c.sent % 2]);
+					++c.sent;
+				}
+				else { epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr); --running; continue; }
+				if (!ok) closed = true;
+			}
+			if (closed) { epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr); --running; }
+		}
 	}
+	double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+	for (size_t i = 0; i < conns.size(); ++i) close(conns[i].fd);
+	close(ep);
 
-	for (int i = 0; i < cnt; ++i) delete[] names[i];
-	delete[] names; delete[] diffs; delete[] timesec; delete[] scores; delete[] hintsArr;
+	char line[256];
+	long long done = (long long)latency.size();
+	sprintf_s(line, sizeof(line), "%lld commands in %.2f s (%.0f commands/s).", done, secs, secs > 0 ? done / secs : 0.0);
+	cout << line << "\n";
+	int p50 = hostPercentile(latency, 0.50), p99 = hostPercentile(latency, 0.99), pmax = hostPercentile(latency, 1.0);
+	sprintf_s(line, sizeof(line), "Round trip: p50 %.1f us, p99 %.1f us, max %.1f us.", p50 / 1000.0, p99 / 1000.0, pmax / 1000.0);
+	cout << line << "\n";
 }
 
-/* ========== Achievements & Summary helpers ========== */
+#else
 
-int countTotalAssignableItems() {
-	int c = 0;
-	for (int i = 0; i < totalObjects; ++i) if (objectGivesItem[i] && strlen(objectItemName[i]) > 0) ++c;
-	return c;
+void runServer(int port, int threads) {
+	cout << "Server mode is not supported on this platform (it needs Linux epoll).\n";
 }
 
-bool inventoryContains(const char* name) {
-	if (!name || strlen(name) == 0) return false;
-	string t = toLowerTrim(string(name));
-	for (int i = 0; i < invCount; ++i) {
-		if (toLowerTrim(string(inventory[i])) == t) return true;
-	}
-	return false;
+void runLoadGen(int port, int connections, int active, long long commands) {
+	cout << "The load generator is not supported on this platform (it needs Linux epoll).\n";
 }
 
-void captureLastGameSummary(int roomsExplored) {
-	// free previous snapshot
-	if (lastItemsCollected) {
-		for (int i = 0; i < lastItemsCount; ++i) delete[] lastItemsCollected[i];
-		delete[] lastItemsCollected; lastItemsCollected = nullptr;
-	}
-	lastItemsCount = 0;
-	if (lastAchievements) {
-		for (int i = 0; i < lastAchievementsCount; ++i) delete[] lastAchievements[i];
-		delete[] lastAchievements; lastAchievements = nullptr;
-	}
-	lastAchievementsCount = 0;
-
-	lastSummaryAvailable = true;
-	lastRoomsExplored = roomsExplored;
-	lastTotalMoves = totalMoves;
-	lastElapsedSec = accumulatedElapsed + (int)difftime(time(nullptr), startTime);
-	lastHintsUsed = hintsUsed;
-	lastDifficulty = difficultyLevel;
-	lastFinalScore = computeScore();
-
-	// copy items
-	if (invCount > 0) {
-		lastItemsCollected = new(nothrow) char*[invCount];
-		if (!lastItemsCollected) { cerr << "Memory alloc failed\n"; exit(1); }
-		for (int i = 0; i < invCount; ++i) lastItemsCollected[i] = allocCstrFromStd(string(inventory[i]));
-		lastItemsCount = invCount;
-	}
-	else {
-		lastItemsCollected = nullptr; lastItemsCount = 0;
-	}
+#endif
 
-	// achievements
-	int achCap = 8;
-	lastAchievements = new(nothrow) char*[achCap];
-	lastAchievementsCount = 0;
-	if (!lastAchievements) { cerr << "Memory alloc failed\n"; exit(1); }
+/* ========== Trace replay ========== */
 
-	// Master Detective: no hints used
-	if (lastHintsUsed == 0) {
-		lastAchievements[lastAchievementsCount++] = allocCstrFromStd(string("Master Detective (No hints used)"));
-	}
-	// Speedrunner: under 5 minutes (300 sec)
-	if (lastElapsedSec <= 300) lastAchievements[lastAchievementsCount++] = allocCstrFromStd(string("Speedrunner (Under 05:00)"));
-	// Collector: collected all assignable items
-	int totalAssignable = countTotalAssignableItems();
-	int collected = lastItemsCount;
-	if (totalAssignable > 0 && collected >= totalAssignable) lastAchievements[lastAchievementsCount++] = allocCstrFromStd(string("Collector (All items collected)"));
-	// Perfectionist: score 100/100
-	if (lastFinalScore >= 100) lastAchievements[lastAchievementsCount++] = allocCstrFromStd(string("Perfectionist (Perfect score)"));
-	// If none, store "None"
-	if (lastAchievementsCount == 0) lastAchievements[lastAchievementsCount++] = allocCstrFromStd(string("None"));
+uint64_t digestBytes(uint64_t h, const void* p, size_t n) {
+	const unsigned char* b = (const unsigned char*)p;
+	for (size_t i = 0; i < n; ++i) { h ^= b[i]; h *= 1099511628211ull; }
+	return h;
+}
 
-	// resize array to actual count (not necessary but okay)
+// FNV-1a over the state a replay has to reproduce. The clock-dependent
+// parts (elapsed time, and so the score) are left out.
+uint64_t sessionDigest(GameSession &gs) {
+	uint64_t h = 14695981039346656037ull;
+	int counters[4] = { gs.difficultyLevel, gs.currentRoomIndex, gs.totalMoves, gs.hintsUsed };
+	h = digestBytes(h, counters, sizeof(counters));
+	h = digestBytes(h, &gs.layoutSeed, sizeof(gs.layoutSeed));
+	h = digestBytes(h, gs.objectSolvedBits, solvedWordCount() * sizeof(unsigned int));
+	// names rather than ids, so digests do not depend on the dictionary order
+	for (int i = 0; i < gs.invCount; ++i) h = digestBytes(h, itemNames[gs.inventory[i]], strlen(itemNames[gs.inventory[i]]) + 1);
+	return h;
 }
 
-/* ========== Final summary display ========== */
+struct ReplayTrace {
+	bool network = false;
+	bool typos = true;
+	vector<string> lines;
+	deque<uint64_t> seeds;
+	long long recordedMs = 0;
+	bool hasEnd = false;
+	uint64_t digest = 0;
+};
 
-void formatTime(int sec, char* out, int outSize) {
-	int mm = sec / 60;
-	int ss = sec % 60;
-	sprintf_s(out, outSize, "%02d:%02d", mm, ss);
+bool traceGetVarint(const vector<char> &d, size_t &pos, uint64_t &v) {
+	v = 0;
+	for (int shift = 0; shift < 64 && pos < d.size(); shift += 7) {
+		unsigned char b = (unsigned char)d[pos++];
+		v |= (uint64_t)(b & 0x7F) << shift;
+		if (!(b & 0x80)) return true;
+	}
+	return false;
 }
 
-void showLastGameSummary() {
-	if (!lastSummaryAvailable) { cout << "No last-game summary available.\n"; return; }
-	clearScreen();
-	cout << "===================== GAME SUMMARY =====================\n";
-	cout << "Total rooms explored : " << lastRoomsExplored << "\n";
-	cout << "Total moves : " << lastTotalMoves << "\n";
-	char timestr[32]; formatTime(lastElapsedSec, timestr, sizeof(timestr));
-	cout << "Time taken : " << timestr << "\n";
-	cout << "Hints used : " << lastHintsUsed << "\n";
-	cout << "Items collected : ";
-	if (lastItemsCount == 0) cout << "None\n";
-	else {
-		for (int i = 0; i < lastItemsCount; ++i) {
-			cout << lastItemsCollected[i];
-			if (i + 1 < lastItemsCount) cout << ", ";
+// Reads a whole trace; false with 'err' set when it cannot be replayed here.
+// A trace cut short (no END record) still replays, without the final check.
+bool readTrace(const char* path, ReplayTrace &t, string &err) {
+	ifstream fin(path, ios::binary | ios::ate);
+	if (!fin) { err = "cannot open file"; return false; }
+	vector<char> d((size_t)fin.tellg());
+	fin.seekg(0);
+	fin.read(d.data(), (streamsize)d.size());
+	if (d.size() < 10 || memcmp(d.data(), "ESCT", 4) != 0) { err = "not a trace file"; return false; }
+	if ((unsigned char)d[4] != TRACE_VERSION) { err = "unsupported trace version"; return false; }
+	t.network = (d[5] & 1) != 0;
+	t.typos = (d[5] & 2) == 0;
+	uint32_t objects = 0;
+	memcpy(&objects, d.data() + 6, sizeof(objects));
+	if ((int)objects != totalObjects) { err = "recorded with a different room catalog"; return false; }
+	size_t pos = 10;
+	while (pos < d.size() && !t.hasEnd) {
+		unsigned char type = (unsigned char)d[pos++];
+		uint64_t ms = 0, len = 0, value = 0;
+		switch (type) {
+		case TR_LINE:
+			if (!traceGetVarint(d, pos, ms) || !traceGetVarint(d, pos, len) || len > d.size() - pos) { pos = d.size(); break; }
+			t.lines.push_back(string(d.data() + pos, (size_t)len));
+			t.recordedMs += (long long)ms;
+			pos += (size_t)len;
+			break;
+		case TR_SEED:
+		case TR_END:
+			if (d.size() - pos < sizeof(value)) { pos = d.size(); break; }
+			memcpy(&value, d.data() + pos, sizeof(value));
+			pos += sizeof(value);
+			if (type == TR_SEED) t.seeds.push_back(value);
+			else { t.digest = value; t.hasEnd = true; }
+			break;
+		case TR_LOAD:
+			err = "the session resumed a saved game, which the trace does not contain";
+			return false;
+		default:
+			err = "corrupted record";
+			return false;
 		}
-		cout << "\n";
 	}
-	string dstr = (lastDifficulty == 1 ? "Easy" : (lastDifficulty == 2 ? "Medium" : "Hard"));
-	cout << "Difficulty : " << dstr << "\n";
-	cout << "Final Score : " << lastFinalScore << "/100\n";
-	cout << "--------------------------------------------------------\n";
-	cout << "Achievements Unlocked:\n";
-	for (int i = 0; i < lastAchievementsCount; ++i) {
-		cout << "- " << lastAchievements[i] << "\n";
+	return true;
+}
+
+// Escape.exe --replay [--echo] trace... feeds each trace through the game
+// flow as fast as it will go, with no terminal I/O unless --echo is given,
+// and checks that every session ends in its recorded state.
+void runReplay(const vector<const char*> &paths, bool echo) {
+	ostream nullOut(nullptr); // bad stream: every write is skipped
+	long long totalLines = 0;
+	double totalSecs = 0;
+	int matched = 0, failed = 0;
+	for (size_t i = 0; i < paths.size(); ++i) {
+		ReplayTrace t;
+		string err;
+		if (!readTrace(paths[i], t, err)) { cout << paths[i] << ": " << err << ".\n"; ++failed; continue; }
+		GameSession gs;
+		if (!allocSession(gs)) return;
+		PlayerIO io;
+		io.out = echo ? &cout : &nullOut;
+		io.network = t.network;
+		io.dryRun = true;
+		io.replaySeeds = t.seeds;
+		typoTolerance = t.typos;
+		size_t fed = 0;
+		chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+		{
+			Task<void> session = playerMain(gs, io);
+			session.start();
+			while (fed < t.lines.size() && !session.done()) feedLine(io, t.lines[fed++]);
+		}
+		double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+		totalSecs += secs;
+		totalLines += (long long)fed;
+		cout << paths[i] << ": " << fed << " line(s), recorded over " << (t.recordedMs / 1000.0) << " s: ";
+		if (fed < t.lines.size()) { cout << "MISMATCH (the session ended before its input did)\n"; ++failed; }
+		else if (!t.hasEnd) { cout << "replayed (trace has no end record to check)\n"; ++matched; }
+		else if (sessionDigest(gs) != t.digest) { cout << "MISMATCH (end state differs)\n"; ++failed; }
+		else { cout << "OK\n"; ++matched; }
+		freeSession(gs);
 	}
-	cout << "--------------------------------------------------------\n";
+	char line[256];
+	sprintf_s(line, sizeof(line), "Replayed %lld line(s) in %.2f ms (%.0f lines/s): %d trace(s) OK, %d failed.",
+		totalLines, totalSecs * 1000.0, totalSecs > 0 ? totalLines / totalSecs : 0.0, matched, failed);
+	cout << line << "\n";
 }
 
 /* ========== Game flow ========== */
 
-void startNewGame() {
+// Layout seed for a game the player starts: recorded into the player's
+// trace, or taken back from it when replaying.
+uint64_t playerSeed(PlayerIO &io) {
+	uint64_t seed;
+	if (io.dryRun && !io.replaySeeds.empty()) { seed = io.replaySeeds.front(); io.replaySeeds.pop_front(); }
+	else seed = newGameSeed();
+	if (io.trace) traceValue(*io.trace, TR_SEED, seed);
+	return seed;
+}
+
+Task<void> startNewGame(GameSession &gs, PlayerIO &io) {
+	ostream &out = *io.out;
 	// reset the quit-to-main flag when a fresh game starts
-	exitToMainRequested = false;
+	gs.exitToMainRequested = false;
 
 	clearScreen();
-	cout << "Select difficulty: 1=Easy  2=Medium  3=Hard\nEnter: ";
-	int d = readIntInRange(1, 3);
-	difficultyLevel = d;
-	// reset solved flags
-	for (int i = 0; i < totalObjects; ++i) objectSolved[i] = 0;
-	// clear inventory
-	for (int i = 0; i < invCount; ++i) delete[] inventory[i];
-	delete[] inventory; inventory = nullptr; invCount = 0; invCapacity = 0;
-	// randomize puzzles
-	randomizePuzzles();
-	// counters
-	currentRoomIndex = 0;
-	totalMoves = 0;
-	hintsUsed = 0;
-	accumulatedElapsed = 0;
-	startTime = time(nullptr);
+	out << "Select difficulty: 1=Easy  2=Medium  3=Hard\nEnter: ";
+	int d = co_await askIntInRange(io, 1, 3);
+	// a reload may have landed while the player sat at a prompt
+	adoptLiveCatalog(gs);
+	// reset solved flags, inventory and counters and shuffle the puzzles
+	engineNewGame(gs, d, playerSeed(io));
 
 	int roomsExplored = 0;
 	for (int r = 0; r < totalRooms; ++r) {
 		// if user requested quit to main from prior room, stop immediately
-		if (exitToMainRequested) break;
-		currentRoomIndex = r;
-		playRoomLoop(r);
+		if (gs.exitToMainRequested) break;
+		gs.currentRoomIndex = r;
+		co_await playRoomLoop(gs, io, r);
 
 		// Check if user quit to main menu
-		if (exitToMainRequested) break;
+		if (gs.exitToMainRequested) break;
 
 		// Check if current room is completed before proceeding
-		if (!isRoomCompleted(r)) {
+		if (!isRoomCompleted(gs, r)) {
 			// Room not completed, don't proceed to next room
-			cout << "You need to complete all puzzles in this room before proceeding!\n";
-			pressEnterToContinue();
+			out << "You need to complete all puzzles in this room before proceeding!\n";
+			co_await askEnter(io);
 			r--; // Stay in current room
 			continue;
 		}
@@ -1143,68 +6445,73 @@ void startNewGame() {
 	}
 
 	// if user quit early, just return to main menu without finishing end-of-game flow
-	if (exitToMainRequested) {
-		cout << "Returning to main menu...\n";
-		pressEnterToContinue();
-		return;
+	if (gs.exitToMainRequested) {
+		out << "Returning to main menu...\n";
+		co_await askEnter(io);
+		co_return;
 	}
 
 	// Only show completion message if all rooms were actually completed
 	if (roomsExplored == totalRooms) {
-		int elapsed = accumulatedElapsed + (int)difftime(time(nullptr), startTime);
-		int finalScore = computeScore();
-		cout << "\nYou escaped all rooms!\n";
+		int elapsed = gs.accumulatedElapsed + (int)difftime(time(nullptr), gs.startTime);
+		int finalScore = computeScore(gs);
+		out << "\nYou escaped all rooms!\n";
 		char timestr[32]; formatTime(elapsed, timestr, sizeof(timestr));
-		cout << "Time: " << timestr << " (" << elapsed << " seconds)\n";
-		cout << "Moves: " << totalMoves << "   Hints used: " << hintsUsed << "\n";
-		cout << "Final score: " << finalScore << "/100\n";
+		out << "Time: " << timestr << " (" << elapsed << " seconds)\n";
+		out << "Moves: " << gs.totalMoves << "   Hints used: " << gs.hintsUsed << "\n";
+		out << "Final score: " << finalScore << "/100\n";
 
 		// capture snapshot for main menu display and achievements
-		captureLastGameSummary(roomsExplored);
+		captureLastGameSummary(gs, roomsExplored);
 
 		// prompt to save progress
-		cout << "Do you want to save your progress? (y/n): ";
-		if (readYesNo()) {
-			saveProgress();
+		if (!io.network) {
+			out << "Do you want to save your progress? (y/n): ";
+			if (co_await askYesNo(io) && !io.dryRun) {
+				saveProgress(gs, out);
+			}
 		}
 
 		// highscore entry
-		cout << "Enter your name for high score (max " << (MAX_PLAYER_NAME - 1) << " chars): ";
-		string pname = readLineTrimmedFromCin();
+		out << "Enter your name for high score (max " << (MAX_PLAYER_NAME - 1) << " chars): ";
+		string pname = co_await askLine(io);
 		if (pname.empty()) pname = "Player";
 		if (pname.size() > (MAX_PLAYER_NAME - 1)) pname = pname.substr(0, MAX_PLAYER_NAME - 1);
-		appendHighScore(pname.c_str(), finalScore, elapsed, difficultyLevel, hintsUsed);
+		if (!io.dryRun) appendHighScore(pname.c_str(), finalScore, elapsed, gs.difficultyLevel, gs.hintsUsed, out);
 
-		cout << "Play again? (y/n): ";
-		if (readYesNo()) startNewGame();
-		else { cout << "Returning to main menu...\n"; pressEnterToContinue(); }
+		out << "Play again? (y/n): ";
+		if (co_await askYesNo(io)) co_await startNewGame(gs, io);
+		else { out << "Returning to main menu...\n"; co_await askEnter(io); }
 	}
 	else {
-		cout << "Game incomplete. Returning to main menu...\n";
-		pressEnterToContinue();
+		out << "Game incomplete. Returning to main menu...\n";
+		co_await askEnter(io);
 	}
 }
 
-void resumeSavedGame() {
+Task<void> resumeSavedGame(GameSession &gs, PlayerIO &io) {
+	ostream &out = *io.out;
 	// reset quit flag for resumed session
-	exitToMainRequested = false;
+	gs.exitToMainRequested = false;
 
-	if (!loadProgress()) { pressEnterToContinue(); return; }
+	if (io.trace) traceValue(*io.trace, TR_LOAD, 0);
+	adoptLiveCatalog(gs);
+	if (!loadProgress(gs)) { co_await askEnter(io); co_return; }
 	// continue
 	int roomsExplored = 0;
-	for (int r = currentRoomIndex; r < totalRooms; ++r) {
-		if (exitToMainRequested) break;
-		currentRoomIndex = r;
-		playRoomLoop(r);
+	for (int r = gs.currentRoomIndex; r < totalRooms; ++r) {
+		if (gs.exitToMainRequested) break;
+		gs.currentRoomIndex = r;
+		co_await playRoomLoop(gs, io, r);
 
 		// Check if user quit to main menu
-		if (exitToMainRequested) break;
+		if (gs.exitToMainRequested) break;
 
 		// Check if current room is completed before proceeding
-		if (!isRoomCompleted(r)) {
+		if (!isRoomCompleted(gs, r)) {
 			// Room not completed, don't proceed to next room
-			cout << "You need to complete all puzzles in this room before proceeding!\n";
-			pressEnterToContinue();
+			out << "You need to complete all puzzles in this room before proceeding!\n";
+			co_await askEnter(io);
 			r--; // Stay in current room
 			continue;
 		}
@@ -1212,69 +6519,212 @@ void resumeSavedGame() {
 		roomsExplored++;
 	}
 	// if user quit early, just return to main menu
-	if (exitToMainRequested) {
-		cout << "Returning to main menu...\n";
-		pressEnterToContinue();
-		return;
+	if (gs.exitToMainRequested) {
+		out << "Returning to main menu...\n";
+		co_await askEnter(io);
+		co_return;
 	}
 
 	// Only show completion message if all rooms were actually completed
-	if (roomsExplored == totalRooms - currentRoomIndex) {
-		int elapsed = accumulatedElapsed + (int)difftime(time(nullptr), startTime);
-		int finalScore = computeScore();
-		cout << "\nYou escaped all rooms!\n";
+	if (roomsExplored == totalRooms - gs.currentRoomIndex) {
+		int elapsed = gs.accumulatedElapsed + (int)difftime(time(nullptr), gs.startTime);
+		int finalScore = computeScore(gs);
+		out << "\nYou escaped all rooms!\n";
 		char timestr[32]; formatTime(elapsed, timestr, sizeof(timestr));
-		cout << "Time: " << timestr << "\n";
-		cout << "Moves: " << totalMoves << "   Hints used: " << hintsUsed << "\n";
-		cout << "Final score: " << finalScore << "/100\n";
+		out << "Time: " << timestr << "\n";
+		out << "Moves: " << gs.totalMoves << "   Hints used: " << gs.hintsUsed << "\n";
+		out << "Final score: " << finalScore << "/100\n";
 
-		captureLastGameSummary(roomsExplored);
+		captureLastGameSummary(gs, roomsExplored);
 
-		cout << "Do you want to save your progress? (y/n): ";
-		if (readYesNo()) saveProgress();
+		out << "Do you want to save your progress? (y/n): ";
+		if (co_await askYesNo(io)) saveProgress(gs, out);
 
-		cout << "Enter your name for high score (max " << (MAX_PLAYER_NAME - 1) << " chars): ";
-		string pname = readLineTrimmedFromCin();
+		out << "Enter your name for high score (max " << (MAX_PLAYER_NAME - 1) << " chars): ";
+		string pname = co_await askLine(io);
 		if (pname.empty()) pname = "Player";
 		if (pname.size() > (MAX_PLAYER_NAME - 1)) pname = pname.substr(0, MAX_PLAYER_NAME - 1);
-		appendHighScore(pname.c_str(), finalScore, accumulatedElapsed + (int)difftime(time(nullptr), startTime), difficultyLevel, hintsUsed);
+		appendHighScore(pname.c_str(), finalScore, gs.accumulatedElapsed + (int)difftime(time(nullptr), gs.startTime), gs.difficultyLevel, gs.hintsUsed, out);
 	}
 	else {
-		cout << "Game incomplete. Progress saved.\n";
+		out << "Game incomplete. Progress saved.\n";
+	}
+
+	out << "Returning to main menu...\n";
+	co_await askEnter(io);
+}
+
+// The main menu; returns when the player picks Exit.
+Task<void> playerMain(GameSession &gs, PlayerIO &io) {
+	ostream &out = *io.out;
+	while (true) {
+		// a console session gets its tables when its first game starts
+		if (gs.catalog) adoptLiveCatalog(gs);
+		clearScreen();
+		out << takeCatalogNotices();
+		out << "=====================================\n";
+		out << "     ESCAPE ROOM SIMULATOR\n";
+		out << "=====================================\n";
+		out << "1. Start New Game\n2. Load Saved Game\n3. View High Scores\n4. View Last Game Summary\n5. Exit\n";
+		out << "Enter choice: ";
+		int ch = co_await askIntInRange(io, 1, 5);
+		if (ch == 1) co_await startNewGame(gs, io);
+		else if (ch == 2) {
+			if (!io.network) co_await resumeSavedGame(gs, io);
+			else { out << "Saved games are not available on the server.\n"; co_await askEnter(io); }
+		}
+		else if (ch == 3) {
+			clearScreen();
+			out << "Filter by difficulty (0=All, 1=Easy, 2=Medium, 3=Hard): ";
+			int filter = co_await askIntInRange(io, 0, 3);
+			if (!io.dryRun) showHighScores(filter, out);
+			co_await askEnter(io);
+		}
+		else if (ch == 4) { clearScreen(); showLastGameSummary(gs, out); co_await askEnter(io); }
+		else { out << "Goodbye!\n"; break; }
 	}
+}
 
-	cout << "Returning to main menu...\n";
-	pressEnterToContinue();
+// Drives a session from cin until it finishes or input ends.
+void runConsole(GameSession &gs) {
+	PlayerIO io;
+	TraceWriter trace;
+	if (!tracePath.empty()) {
+		if (traceOpen(trace, tracePath, false)) io.trace = &trace;
+		else cout << "Unable to open trace file '" << tracePath << "'.\n";
+	}
+	Task<void> session = playerMain(gs, io);
+	session.start();
+	string line;
+	while (!session.done() && getline(cin, line)) feedLine(io, line);
+	if (io.trace) {
+		// a replay digests an allocated session even if no game was played
+		if (!gs.catalog) adoptLiveCatalog(gs);
+		traceClose(trace, sessionDigest(gs));
+	}
 }
 
+int main(int argc, char** argv) {
+	gameSeedBase = (uint64_t)chrono::system_clock::now().time_since_epoch().count();
+	if (!parseGameOptions(argc, argv)) return 1;
+
+	// Escape.exe --compile-pack [rooms.txt] [rooms.bin]
+	if (argc >= 2 && strcmp(argv[1], "--compile-pack") == 0) {
+		const char* in = argc >= 3 ? argv[2] : ROOMS_TXT;
+		const char* out = argc >= 4 ? argv[3] : ROOMS_PACK;
+		return compileRoomPack(in, out) ? 0 : 1;
+	}
+
+	// Escape.exe --compact-scores
+	if (argc >= 2 && strcmp(argv[1], "--compact-scores") == 0) {
+		bool ok = importLegacyHighScores() && compactLeaderboard();
+		cout << (ok ? "High scores compacted.\n" : "Compaction failed or already running.\n");
+		return ok ? 0 : 1;
+	}
+
+	// Escape.exe --loadgen [port] [connections] [active] [commands per active connection]
+	if (argc >= 2 && strcmp(argv[1], "--loadgen") == 0) {
+		int port = argc >= 3 ? atoi(argv[2]) : NET_DEFAULT_PORT;
+		int connections = argc >= 4 ? atoi(argv[3]) : 1000;
+		int active = argc >= 5 ? atoi(argv[4]) : 100;
+		long long commands = argc >= 6 ? atoll(argv[5]) : 1000;
+		runLoadGen(port, connections > 0 ? connections : 1, active > 0 ? active : 1, commands > 0 ? commands : 1);
+		return 0;
+	}
+
+	// Escape.exe --bench-levenshtein [pairs]
+	if (argc >= 2 && strcmp(argv[1], "--bench-levenshtein") == 0) {
+		int pairs = argc >= 3 ? atoi(argv[2]) : 10000;
+		runLevenshteinBench(pairs > 0 ? pairs : 1);
+		return 0;
+	}
 
+	// Escape.exe --bench-text [rooms file] [rounds]
+	if (argc >= 2 && strcmp(argv[1], "--bench-text") == 0) {
+		const char* file = argc >= 3 && strncmp(argv[2], "--", 2) != 0 ? argv[2] : ROOMS_TXT;
+		int rounds = argc >= 4 ? atoi(argv[3]) : 10;
+		runTextBench(file, rounds > 0 ? rounds : 1);
+		return 0;
+	}
 
-int main() {
-	srand((unsigned int)time(nullptr));
+	// Escape.exe --simulate [sessions per difficulty/strategy] [threads] [seed]
+	bool simulate = argc >= 2 && strcmp(argv[1], "--simulate") == 0;
+	// Escape.exe --host-bench [sessions] [commands]
+	bool hostBench = argc >= 2 && strcmp(argv[1], "--host-bench") == 0;
+	bool replay = argc >= 2 && strcmp(argv[1], "--replay") == 0;
+	bool server = argc >= 2 && strcmp(argv[1], "--server") == 0;
 
-	cout << "Loading rooms from '" << ROOMS_TXT << "'...\n";
-	if (!loadRoomsFromFile(ROOMS_TXT)) {
+	// only the console reads rooms lazily; the batch modes and the server
+	// share the catalog across threads and need all of it up front, and a
+	// watched catalog is reloaded from whole versions
+	if (!loadCatalog(!(simulate || hostBench || replay || server || watchCatalog))) {
 		cout << "Failed to load rooms. Make sure '" << ROOMS_TXT << "' exists and is formatted correctly.\n";
 		cout << "Press Enter to exit.\n"; getline(cin, *(new string));
 		freeAllMemory();
 		return 0;
 	}
 
-	while (true) {
-		clearScreen();
-		cout << "=====================================\n";
-		cout << "     ESCAPE ROOM SIMULATOR\n";
-		cout << "=====================================\n";
-		cout << "1. Start New Game\n2. Load Saved Game\n3. View High Scores\n4. View Last Game Summary\n5. Exit\n";
-		cout << "Enter choice: ";
-		int ch = readIntInRange(1, 5);
-		if (ch == 1) startNewGame();
-		else if (ch == 2) resumeSavedGame();
-		else if (ch == 3) { clearScreen(); showHighScores(); pressEnterToContinue(); }
-		else if (ch == 4) { clearScreen(); showLastGameSummary(); pressEnterToContinue(); }
-		else { cout << "Goodbye!\n"; break; }
+	if (simulate) {
+		long long sessions = argc >= 3 ? atoll(argv[2]) : 100000;
+		int threads = argc >= 4 ? atoi(argv[3]) : (int)thread::hardware_concurrency();
+		uint64_t seed = argc >= 5 ? (uint64_t)atoll(argv[4]) : (uint64_t)time(nullptr);
+		if (sessions < 1) sessions = 1;
+		runSimulation(sessions, threads, seed);
+		freeAllMemory();
+		return 0;
+	}
+
+	// Escape.exe --replay [--echo] trace...
+	if (replay) {
+		bool echo = false;
+		vector<const char*> paths;
+		for (int i = 2; i < argc; ++i) {
+			if (strcmp(argv[i], "--echo") == 0) echo = true;
+			else if (strncmp(argv[i], "--", 2) != 0) paths.push_back(argv[i]);
+		}
+		runReplay(paths, echo);
+		freeAllMemory();
+		return 0;
+	}
+
+	// Escape.exe --server [port] [threads]
+	if (server) {
+		int port = argc >= 3 ? atoi(argv[2]) : NET_DEFAULT_PORT;
+		int threads = argc >= 4 ? atoi(argv[3]) : 2;
+		startLeaderboardCompactor();
+		if (watchCatalog) startCatalogWatcher();
+		runServer(port, threads);
+		stopCatalogWatcher();
+		stopLeaderboardCompactor();
+		freeAllMemory();
+		return 0;
+	}
+
+	if (hostBench) {
+		int sessions = argc >= 3 ? atoi(argv[2]) : 10000;
+		long long commands = argc >= 4 ? atoll(argv[3]) : 1000000;
+		if (sessions < 1) sessions = 1;
+		if (commands < 1) commands = 1;
+		runHostBench(sessions, commands);
+		freeAllMemory();
+		return 0;
 	}
 
+	// the session's tables are allocated when the first game starts, so an
+	// indexed catalog reaches the menu without touching every room
+	GameSession player;
+
+	startLeaderboardCompactor();
+	startSaveWriter();
+	holdCatalogNotices = true;
+	if (watchCatalog) startCatalogWatcher();
+	runConsole(player);
+	stopCatalogWatcher();
+	stopSaveWriter();
+	reportSaveFailure(cout);
+	stopLeaderboardCompactor();
+
+	freeSession(player);
 	freeAllMemory();
 	system("pause");
 	return 0;